@@ -0,0 +1,11 @@
+# Runs PLAIN and FUSED and fails unless both succeed with the same output
+foreach(program PLAIN FUSED)
+    execute_process(COMMAND ${${program}} OUTPUT_VARIABLE ${program}_OUTPUT RESULT_VARIABLE result)
+    if(NOT result EQUAL 0)
+        message(FATAL_ERROR "${${program}} failed: ${result}")
+    endif()
+endforeach()
+if(NOT PLAIN_OUTPUT STREQUAL FUSED_OUTPUT)
+    message(FATAL_ERROR "Fused loops changed the output\nAs written:\n${PLAIN_OUTPUT}\nFused:\n${FUSED_OUTPUT}")
+endif()
+message(STATUS "Outputs match:\n${FUSED_OUTPUT}")
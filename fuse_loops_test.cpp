@@ -0,0 +1,36 @@
+#include <iostream>
+#include <stdexcept>
+#include <vector>
+#include "laic.h"
+
+// Chains the preprocessor can fuse into loops. Built once as written and once with
+// --fuse-loops; the fuse_loops test checks that both builds print the same
+int main() {
+    std::vector<int> data;
+    for (int i = 0; i < 50; ++i) data.push_back((i * 37) % 23 - 5);
+    MyRange<int> range(data);
+    MyRange<int> empty;
+    int limit = 4;
+
+#ssb
+    std::cout << "Where Count: " << range.Where[value > 3].Count() << std::endl;
+    std::cout << "Take Skip Count: " << range.Take(3).Skip(1).Count() << std::endl;
+    std::cout << "Skip Count: " << range.Skip(60).Count() << std::endl;
+    std::cout << "Select Sum: " << range.Select[value * 3 + 1].Sum() << std::endl;
+    std::cout << "Where Select Take Sum: " << range.Where[value % 2 == 0].Select[value * value].Take(limit).Sum() << std::endl;
+    std::cout << "Skip Min: " << range.Skip(10).Min() << std::endl;
+    std::cout << "Where Max: " << range.Where[value < 10].Max() << std::endl;
+    std::cout << "Select Average: " << range.Select[value / 2.0].Average() << std::endl;
+    std::cout << "Where Average: " << range.Where[value > 100].Average() << std::endl;
+    std::cout << "Select Any: " << range.Select[value - 1].Any[value == 16] << std::endl;
+    std::cout << "Take All: " << range.Take(5).All[value > -5] << std::endl;
+    std::cout << "Nested: " << range.Where[range.Where[value > 0].Count() > 5 && value > 0].Count() << std::endl;
+    try {
+        std::cout << "Empty Min: " << empty.Where[value > 0].Min() << std::endl;
+    } catch (const std::logic_error& error) {
+        std::cout << error.what() << std::endl;
+    }
+#esb
+
+    return 0;
+}
@@ -17,78 +17,1337 @@
 #include <type_traits>
 #include <unordered_set>
 #include <string>
+#include <string_view>
+#include <optional>
+#include <tuple>
+#include <atomic>
+#include <mutex>
+#include <climits>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+#include "laic_memory.h"
+#include "laic_simd.h"
+#include "laic_hash.h"
+#include "laic_sort.h"
+#include "laic_profile.h"
+
+// Elements per batch handed from stage to stage; a batch with its selection vector stays in L1/L2
+constexpr size_t BatchSize = 1024;
+
+// True when batches of T can be gathered into a contiguous buffer, which std::vector<bool> lacks
+template <typename T>
+constexpr bool IsBatchable = !std::is_same<T, bool>::value;
+
+// True when == holds only between identical values, so that no predicate can tell apart two
+// elements Distinct treats as one. Not so for -0.0 and 0.0, or for a struct comparing some fields
+template <typename T>
+constexpr bool EqualityIsIdentity = std::is_integral<T>::value || std::is_same<T, std::string>::value;
+
+// Start of a gathered batch; never used for element types that are not batchable
+template <typename T>
+const T* BatchData(const ArenaVector<T>& batch) {
+    if constexpr (IsBatchable<T>) {
+        return batch.data();
+    } else {
+        return nullptr;
+    }
+}
+
+// Refills a batch buffer with make(0) ... make(count - 1), reusing its storage once warm
+template <typename T, typename Make>
+void FillBatch(ArenaVector<T>& batch, size_t count, Make make) {
+    if constexpr (std::is_default_constructible<T>::value) {
+        batch.resize(count);
+        for (size_t i = 0; i < count; ++i) batch[i] = make(i);
+    } else {
+        batch.clear();
+        for (size_t i = 0; i < count; ++i) batch.push_back(make(i));
+    }
+}
+
+template <typename T>
+class Sink;
+
+// Pushes count contiguous values into sink in batches that start small and double up to
+// BatchSize, so a chain that stops early evaluates at most about twice the elements it needed
+template <typename T>
+void PushBatches(Sink<T>& sink, const T* values, size_t count) {
+    size_t size = 16;
+    for (size_t offset = 0; offset < count; offset += size, size = std::min(size * 2, BatchSize)) {
+        if (!sink.PushBatch(values + offset, std::min(size, count - offset))) return;
+    }
+}
+
+// Pushes data[first, last) into sink, batched unless T is not batchable
+template <typename T>
+void PushSlice(Sink<T>& sink, const std::vector<T>& data, size_t first, size_t last) {
+    last = std::min(last, data.size());
+    if constexpr (!IsBatchable<T>) {
+        for (size_t i = first; i < last; ++i) {
+            if (!sink.Push(data[i])) break;
+        }
+    } else if (first < last) {
+        PushBatches(sink, data.data() + first, last - first);
+    }
+}
+
+// Receiver at the end of a fused operation chain
+template <typename T>
+class Sink {
+public:
+    virtual ~Sink() = default;
+    // Returns false once no further elements are wanted
+    virtual bool Push(const T& value) = 0;
+    // Pushes count contiguous elements, by default one at a time; stages override it to
+    // handle the whole batch in one tight loop and hand a batch on downstream
+    virtual bool PushBatch(const T* values, size_t count) {
+        for (size_t i = 0; i < count; ++i) {
+            if (!Push(values[i])) return false;
+        }
+        return true;
+    }
+    // Called once after the source is exhausted or stopped
+    virtual void Finish() {}
+};
+
+// Sink that forwards every element to a callable
+template <typename T, typename Func>
+class CallbackSink : public Sink<T> {
+public:
+    CallbackSink(Func callback) : callback_(callback) {}
+    bool Push(const T& value) override {
+        return callback_(value);
+    }
+    bool PushBatch(const T* values, size_t count) override {
+        for (size_t i = 0; i < count; ++i) {
+            if (!callback_(values[i])) return false;
+        }
+        return true;
+    }
+private:
+    Func callback_;
+};
+
+// Sink folding into result one element at a time with func, or a whole batch at once with batchFunc
+template <typename T, typename Result, typename Func, typename BatchFunc>
+class BatchFoldSink : public Sink<T> {
+public:
+    BatchFoldSink(Result& result, Func func, BatchFunc batchFunc) : result_(result), func_(func), batchFunc_(batchFunc) {}
+    bool Push(const T& value) override {
+        return func_(result_, value);
+    }
+    bool PushBatch(const T* values, size_t count) override {
+        batchFunc_(result_, values, count);
+        return true;
+    }
+private:
+    Result& result_;
+    Func func_;
+    BatchFunc batchFunc_;
+};
+
+// Shape of a lazy operation, which the plan rewrites in MyRange reason about
+enum class OperationKind { Where, Select, Take, Skip, Concat, Reverse, ReverseTake, Distinct, DistinctBy, Order, Barrier };
+
+// Handle keeping both owners alive; either may be null
+inline std::shared_ptr<const void> CombinePins(std::shared_ptr<const void> first, std::shared_ptr<const void> second) {
+    if (!first) return second;
+    if (!second) return first;
+    using Pair = std::pair<std::shared_ptr<const void>, std::shared_ptr<const void>>;
+    return std::make_shared<const Pair>(std::move(first), std::move(second));
+}
 
 // Base class for lazy operations
 template <typename T>
 class LazyOperation {
 public:
     virtual ~LazyOperation() = default;
-    virtual void Apply(std::vector<T>& data) const = 0;
+    // Owner of storage that elements this operation passes on may refer into, or null
+    virtual std::shared_ptr<const void> Pin() const { return nullptr; }
+    // Creates the per-evaluation stage that feeds downstream, from the current memory resource
+    virtual ArenaPtr<Sink<T>> Wrap(Sink<T>& downstream) const = 0;
+    // True when each element is handled independently, so the input may be split into chunks
+    virtual bool IsElementwise() const { return false; }
+    virtual OperationKind Kind() const = 0;
+    // One-line description for Explain
+    virtual std::string Describe() const = 0;
+    // Terminal stage that only counts the elements this operation would pass on, or null
+    virtual ArenaPtr<Sink<T>> WrapCounter(size_t&) const { return nullptr; }
+#ifdef LAIC_PROFILE
+    OperatorProfile& Profile() const { return profile_; }
+private:
+    mutable OperatorProfile profile_;
+#endif
+};
+
+// Stage that passes elements through, forwarding Finish downstream
+template <typename T>
+class StageSink : public Sink<T> {
+public:
+    StageSink(Sink<T>& downstream) : downstream_(downstream) {}
+    void Finish() override {
+        downstream_.Finish();
+    }
+protected:
+    Sink<T>& downstream_;
+};
+
+#ifdef LAIC_PROFILE
+// Sink in front of an operator's stage recording its input, time and allocations; placed
+// after the last stage instead, it records that operator's output
+template <typename T>
+class ProbeSink : public Sink<T> {
+public:
+    ProbeSink(Sink<T>& downstream, OperatorProfile& profile, bool input) : downstream_(downstream), profile_(profile), input_(input) {}
+    bool Push(const T& value) override {
+        Record(1);
+        ProfileScope scope(profile_, input_);
+        return downstream_.Push(value);
+    }
+    bool PushBatch(const T* values, size_t count) override {
+        Record(count);
+        ProfileScope scope(profile_, input_);
+        return downstream_.PushBatch(values, count);
+    }
+    void Finish() override {
+        ProfileScope scope(profile_, input_);
+        downstream_.Finish();
+    }
+private:
+    void Record(size_t count) {
+        (input_ ? profile_.elementsIn : profile_.elementsOut) += count;
+    }
+
+    Sink<T>& downstream_;
+    OperatorProfile& profile_;
+    bool input_;
+};
+#endif
+
+// Stage forwarding the elements of a batch picked by a selection vector
+template <typename T>
+class FilterStage : public StageSink<T> {
+public:
+    FilterStage(Sink<T>& downstream) : StageSink<T>(downstream) {}
+protected:
+    // Forwards the batch itself when everything passed, otherwise the survivors
+    bool Forward(const T* batch, size_t size, size_t selected) {
+        if (selected == size) return this->downstream_.PushBatch(batch, size);
+        if (selected == 0) return true;
+        if (sizeof(T) > GatherLimit) {
+            for (size_t i = 0; i < selected; ++i) {
+                if (!this->downstream_.Push(batch[selection_[i]])) return false;
+            }
+            return true;
+        }
+        FillBatch(output_, selected, [&](size_t i) { return batch[selection_[i]]; });
+        return this->downstream_.PushBatch(BatchData(output_), selected);
+    }
+
+    // Larger elements are not copied into a batch; each survivor is pushed in place
+    static constexpr size_t GatherLimit = 32;
+
+    uint32_t selection_[BatchSize];
+    ArenaVector<T> output_;
+};
+
+// Filtering operation that can be fused with adjacent filters into one stage
+template <typename T>
+class FilterOperation : public LazyOperation<T> {
+public:
+    bool IsElementwise() const override { return true; }
+    OperationKind Kind() const override { return OperationKind::Where; }
+    virtual bool Test(const T& value) const = 0;
+    // Writes the positions in [0, count) of the elements that pass; returns how many did
+    virtual size_t Scan(const T* values, size_t count, uint32_t* selection) const = 0;
+    // Keeps the positions in selection[0, count) whose elements pass; returns how many remain
+    virtual size_t Refine(const T* values, uint32_t* selection, size_t count) const = 0;
 };
 
 // Lazy operation for filtering elements
 template <typename T, typename Func>
-class WhereOperation : public LazyOperation<T> {
+class WhereOperation : public FilterOperation<T> {
 public:
     WhereOperation(Func predicate) : predicate_(predicate) {}
-    void Apply(std::vector<T>& data) const override {
-        auto it = std::remove_if(data.begin(), data.end(), [&](const T& value) { return !predicate_(value); });
-        data.erase(it, data.end());
+    ArenaPtr<Sink<T>> Wrap(Sink<T>& downstream) const override {
+        return ArenaNew<Stage>(downstream, predicate_);
+    }
+    std::string Describe() const override { return "Where"; }
+    bool Test(const T& value) const override { return predicate_(value); }
+    size_t Scan(const T* values, size_t count, uint32_t* selection) const override {
+        return ScanWith(predicate_, values, count, selection);
+    }
+    size_t Refine(const T* values, uint32_t* selection, size_t count) const override {
+        size_t selected = 0;
+        for (size_t i = 0; i < count; ++i) {
+            const uint32_t index = selection[i];
+            selection[selected] = index;
+            selected += predicate_(values[index]) ? 1 : 0;
+        }
+        return selected;
     }
 private:
+    // Records passing positions without branching
+    static size_t ScanWith(const Func& predicate, const T* values, size_t count, uint32_t* selection) {
+        size_t selected = 0;
+        for (size_t i = 0; i < count; ++i) {
+            selection[selected] = static_cast<uint32_t>(i);
+            selected += predicate(values[i]) ? 1 : 0;
+        }
+        return selected;
+    }
+
+    class Stage : public FilterStage<T> {
+    public:
+        Stage(Sink<T>& downstream, const Func& predicate) : FilterStage<T>(downstream), predicate_(predicate) {}
+        bool Push(const T& value) override {
+            return !predicate_(value) || this->downstream_.Push(value);
+        }
+        bool PushBatch(const T* values, size_t count) override {
+            if (!IsBatchable<T>) return Sink<T>::PushBatch(values, count);
+            for (size_t offset = 0; offset < count; offset += BatchSize) {
+                const size_t size = std::min(BatchSize, count - offset);
+                const size_t selected = ScanWith(predicate_, values + offset, size, this->selection_);
+                if (!this->Forward(values + offset, size, selected)) return false;
+            }
+            return true;
+        }
+    private:
+        const Func& predicate_;
+    };
     Func predicate_;
 };
 
+// Adjacent Where operations fused into one stage: the first filter scans each batch and the
+// rest refine its selection vector, so no intermediate batch is gathered between them
+template <typename T>
+class ConjunctionOperation : public FilterOperation<T> {
+public:
+    ConjunctionOperation(std::vector<std::shared_ptr<const FilterOperation<T>>> filters) : filters_(std::move(filters)) {}
+    ArenaPtr<Sink<T>> Wrap(Sink<T>& downstream) const override {
+        return ArenaNew<Stage>(downstream, *this);
+    }
+    std::string Describe() const override { return "Where(" + std::to_string(filters_.size()) + " predicates)"; }
+    bool Test(const T& value) const override {
+        for (const auto& filter : filters_) {
+            if (!filter->Test(value)) return false;
+        }
+        return true;
+    }
+    size_t Scan(const T* values, size_t count, uint32_t* selection) const override {
+        size_t selected = filters_.front()->Scan(values, count, selection);
+        return Refine(values, selection, selected, 1);
+    }
+    size_t Refine(const T* values, uint32_t* selection, size_t count) const override {
+        return Refine(values, selection, count, 0);
+    }
+    const std::vector<std::shared_ptr<const FilterOperation<T>>>& Filters() const { return filters_; }
+private:
+    size_t Refine(const T* values, uint32_t* selection, size_t count, size_t from) const {
+        for (size_t i = from; i < filters_.size() && count > 0; ++i) {
+            count = filters_[i]->Refine(values, selection, count);
+        }
+        return count;
+    }
+
+    class Stage : public FilterStage<T> {
+    public:
+        Stage(Sink<T>& downstream, const ConjunctionOperation& operation) : FilterStage<T>(downstream), operation_(operation) {}
+        bool Push(const T& value) override {
+            return !operation_.Test(value) || this->downstream_.Push(value);
+        }
+        bool PushBatch(const T* values, size_t count) override {
+            if (!IsBatchable<T>) return Sink<T>::PushBatch(values, count);
+            for (size_t offset = 0; offset < count; offset += BatchSize) {
+                const size_t size = std::min(BatchSize, count - offset);
+                const size_t selected = operation_.Scan(values + offset, size, this->selection_);
+                if (!this->Forward(values + offset, size, selected)) return false;
+            }
+            return true;
+        }
+    private:
+        const ConjunctionOperation& operation_;
+    };
+    std::vector<std::shared_ptr<const FilterOperation<T>>> filters_;
+};
+
 // Lazy operation for transforming elements
 template <typename T, typename Func>
 class SelectOperation : public LazyOperation<T> {
 public:
     SelectOperation(Func selector) : selector_(selector) {}
-    void Apply(std::vector<T>& data) const override {
-        std::transform(data.begin(), data.end(), data.begin(), selector_);
+    ArenaPtr<Sink<T>> Wrap(Sink<T>& downstream) const override {
+        return ArenaNew<Stage>(downstream, selector_);
     }
+    bool IsElementwise() const override { return true; }
+    OperationKind Kind() const override { return OperationKind::Select; }
+    std::string Describe() const override { return "Select"; }
 private:
+    class Stage : public StageSink<T> {
+    public:
+        Stage(Sink<T>& downstream, const Func& selector) : StageSink<T>(downstream), selector_(selector) {}
+        bool Push(const T& value) override {
+            return this->downstream_.Push(selector_(value));
+        }
+        bool PushBatch(const T* values, size_t count) override {
+            if (!IsBatchable<T>) return Sink<T>::PushBatch(values, count);
+            for (size_t offset = 0; offset < count; offset += BatchSize) {
+                const size_t size = std::min(BatchSize, count - offset);
+                FillBatch(output_, size, [&](size_t i) { return selector_(values[offset + i]); });
+                if (!this->downstream_.PushBatch(BatchData(output_), size)) return false;
+            }
+            return true;
+        }
+    private:
+        const Func& selector_;
+        ArenaVector<T> output_;
+    };
     Func selector_;
 };
 
-// Lazy operation for custom operations
+// Lazy operation keeping the first count elements, stopping the source afterwards
+template <typename T>
+class TakeOperation : public LazyOperation<T> {
+public:
+    TakeOperation(size_t count) : count_(count) {}
+    ArenaPtr<Sink<T>> Wrap(Sink<T>& downstream) const override {
+        return ArenaNew<Stage>(downstream, count_);
+    }
+    OperationKind Kind() const override { return OperationKind::Take; }
+    std::string Describe() const override { return "Take(" + std::to_string(count_) + ")"; }
+    size_t Count() const { return count_; }
+private:
+    class Stage : public StageSink<T> {
+    public:
+        Stage(Sink<T>& downstream, size_t remaining) : StageSink<T>(downstream), remaining_(remaining) {}
+        bool Push(const T& value) override {
+            if (remaining_ == 0) return false;
+            --remaining_;
+            return this->downstream_.Push(value) && remaining_ > 0;
+        }
+        bool PushBatch(const T* values, size_t count) override {
+            if (remaining_ == 0) return false;
+            const size_t taken = std::min(count, remaining_);
+            remaining_ -= taken;
+            return this->downstream_.PushBatch(values, taken) && remaining_ > 0;
+        }
+    private:
+        size_t remaining_;
+    };
+    size_t count_;
+};
+
+// Lazy operation dropping the first count elements
+template <typename T>
+class SkipOperation : public LazyOperation<T> {
+public:
+    SkipOperation(size_t count) : count_(count) {}
+    ArenaPtr<Sink<T>> Wrap(Sink<T>& downstream) const override {
+        return ArenaNew<Stage>(downstream, count_);
+    }
+    OperationKind Kind() const override { return OperationKind::Skip; }
+    std::string Describe() const override { return "Skip(" + std::to_string(count_) + ")"; }
+    size_t Count() const { return count_; }
+private:
+    class Stage : public StageSink<T> {
+    public:
+        Stage(Sink<T>& downstream, size_t remaining) : StageSink<T>(downstream), remaining_(remaining) {}
+        bool Push(const T& value) override {
+            if (remaining_ > 0) {
+                --remaining_;
+                return true;
+            }
+            return this->downstream_.Push(value);
+        }
+        bool PushBatch(const T* values, size_t count) override {
+            const size_t skipped = std::min(count, remaining_);
+            remaining_ -= skipped;
+            return skipped == count || this->downstream_.PushBatch(values + skipped, count - skipped);
+        }
+    private:
+        size_t remaining_;
+    };
+    size_t count_;
+};
+
+// Lazy operation passing on the first element seen for each key, in input order
+template <typename T, typename KeySelector>
+class DistinctOperation : public LazyOperation<T> {
+public:
+    DistinctOperation(KeySelector keySelector) : keySelector_(keySelector) {}
+    ArenaPtr<Sink<T>> Wrap(Sink<T>& downstream) const override {
+        return ArenaNew<Stage>(downstream, keySelector_);
+    }
+    OperationKind Kind() const override {
+        return std::is_same<KeySelector, IdentitySelector>::value ? OperationKind::Distinct : OperationKind::DistinctBy;
+    }
+    std::string Describe() const override { return Kind() == OperationKind::Distinct ? "Distinct" : "DistinctBy"; }
+    // Distinct keys are counted in the hash set without forwarding any element
+    ArenaPtr<Sink<T>> WrapCounter(size_t& count) const override {
+        return ArenaNew<CountingStage>(keySelector_, count);
+    }
+private:
+    using KeyType = std::decay_t<decltype(std::declval<KeySelector>()(std::declval<const T&>()))>;
+    class CountingStage : public Sink<T> {
+    public:
+        CountingStage(const KeySelector& keySelector, size_t& count) : keySelector_(keySelector), count_(count) {}
+        bool Push(const T& value) override {
+            count_ += seen_.Insert(keySelector_(value)) ? 1 : 0;
+            return true;
+        }
+        bool PushBatch(const T* values, size_t count) override {
+            for (size_t i = 0; i < count; ++i) {
+                count_ += seen_.Insert(keySelector_(values[i])) ? 1 : 0;
+            }
+            return true;
+        }
+    private:
+        const KeySelector& keySelector_;
+        size_t& count_;
+        DistinctSet<KeyType> seen_;
+    };
+    class Stage : public StageSink<T> {
+    public:
+        Stage(Sink<T>& downstream, const KeySelector& keySelector) : StageSink<T>(downstream), keySelector_(keySelector) {}
+        bool Push(const T& value) override {
+            return !seen_.Insert(keySelector_(value)) || this->downstream_.Push(value);
+        }
+        bool PushBatch(const T* values, size_t count) override {
+            if (!IsBatchable<T>) return Sink<T>::PushBatch(values, count);
+            for (size_t offset = 0; offset < count; offset += BatchSize) {
+                const size_t size = std::min(BatchSize, count - offset);
+                output_.clear();
+                for (size_t i = 0; i < size; ++i) {
+                    if (seen_.Insert(keySelector_(values[offset + i]))) output_.push_back(values[offset + i]);
+                }
+                if (!output_.empty() && !this->downstream_.PushBatch(BatchData(output_), output_.size())) return false;
+            }
+            return true;
+        }
+    private:
+        const KeySelector& keySelector_;
+        DistinctSet<KeyType> seen_;
+        ArenaVector<T> output_;
+    };
+    KeySelector keySelector_;
+};
+
+// Keys of one sort key for a buffer of candidates, compared by buffer position
+template <typename T>
+class KeyColumn {
+public:
+    virtual ~KeyColumn() = default;
+    virtual void Append(const T& value) = 0;
+    virtual void PopBack() = 0;
+    // Keep only the keys at the given ascending positions
+    virtual void Keep(const ArenaVector<size_t>& positions) = 0;
+    // Negative, zero or positive as element a orders before, with or after element b
+    virtual int Compare(size_t a, size_t b) const = 0;
+};
+
+template <typename T, typename KeySelector>
+class SelectorKeyColumn : public KeyColumn<T> {
+public:
+    SelectorKeyColumn(const KeySelector& keySelector, bool descending) : keySelector_(keySelector), descending_(descending) {}
+    void Append(const T& value) override { keys_.push_back(keySelector_(value)); }
+    void PopBack() override { keys_.pop_back(); }
+    void Keep(const ArenaVector<size_t>& positions) override {
+        for (size_t i = 0; i < positions.size(); ++i) {
+            keys_[i] = std::move(keys_[positions[i]]);
+        }
+        keys_.resize(positions.size());
+    }
+    int Compare(size_t a, size_t b) const override {
+        if (keys_[a] < keys_[b]) return descending_ ? 1 : -1;
+        if (keys_[b] < keys_[a]) return descending_ ? -1 : 1;
+        return 0;
+    }
+private:
+    using KeyType = std::decay_t<decltype(std::declval<KeySelector>()(std::declval<const T&>()))>;
+    const KeySelector& keySelector_;
+    ArenaVector<KeyType> keys_;
+    bool descending_;
+};
+
+// One key of an ordering; projects each element once and stably reorders a permutation by it
+template <typename T>
+class SortKey {
+public:
+    virtual ~SortKey() = default;
+    virtual void Sort(const ArenaVector<T>& data, ArenaVector<size_t>& order) const = 0;
+    virtual ArenaPtr<KeyColumn<T>> MakeColumn() const = 0;
+};
+
+template <typename T, typename KeySelector>
+class SelectorSortKey : public SortKey<T> {
+public:
+    SelectorSortKey(KeySelector keySelector, bool descending) : keySelector_(keySelector), descending_(descending) {}
+    void Sort(const ArenaVector<T>& data, ArenaVector<size_t>& order) const override {
+        // Narrow indices halve the bytes moved per radix pass
+        if (order.size() <= UINT32_MAX) {
+            SortWithIndex<uint32_t>(data, order);
+        } else {
+            SortWithIndex<size_t>(data, order);
+        }
+    }
+    ArenaPtr<KeyColumn<T>> MakeColumn() const override {
+        return ArenaNew<SelectorKeyColumn<T, KeySelector>>(keySelector_, descending_);
+    }
+private:
+    using KeyType = std::decay_t<decltype(std::declval<KeySelector>()(std::declval<const T&>()))>;
+
+    template <typename Index>
+    void SortWithIndex(const ArenaVector<T>& data, ArenaVector<size_t>& order) const {
+        ArenaVector<std::pair<KeyType, Index>> keyed;
+        keyed.reserve(order.size());
+        for (size_t index : order) {
+            keyed.emplace_back(keySelector_(data[index]), static_cast<Index>(index));
+        }
+        StableSortPairs(keyed, descending_);
+        for (size_t i = 0; i < keyed.size(); ++i) {
+            order[i] = keyed[i].second;
+        }
+    }
+
+    KeySelector keySelector_;
+    bool descending_;
+};
+
+// Lazy operation sorting the input stably by one or more keys, most significant first.
+// With a limit it emits only the first limit elements of the ordering: candidates are kept
+// with their keys, elements that cannot beat the current limit-th best are dropped on
+// arrival, and the candidates are pruned with nth_element whenever they reach twice the limit
+template <typename T>
+class OrderOperation : public LazyOperation<T> {
+public:
+    OrderOperation(std::vector<std::shared_ptr<const SortKey<T>>> keys, size_t limit = SIZE_MAX) : keys_(std::move(keys)), limit_(limit) {}
+    ArenaPtr<Sink<T>> Wrap(Sink<T>& downstream) const override {
+        if (limit_ == SIZE_MAX) return ArenaNew<SortStage>(downstream, keys_);
+        return ArenaNew<TopStage>(downstream, keys_, limit_);
+    }
+    OperationKind Kind() const override { return OperationKind::Order; }
+    std::string Describe() const override {
+        std::string description = "OrderBy(" + std::to_string(keys_.size()) + (keys_.size() == 1 ? " key" : " keys");
+        if (limit_ != SIZE_MAX) description += ", top " + std::to_string(limit_);
+        return description + ")";
+    }
+    const std::vector<std::shared_ptr<const SortKey<T>>>& Keys() const { return keys_; }
+    size_t Limit() const { return limit_; }
+private:
+    class SortStage : public StageSink<T> {
+    public:
+        SortStage(Sink<T>& downstream, const std::vector<std::shared_ptr<const SortKey<T>>>& keys) : StageSink<T>(downstream), keys_(keys) {}
+        bool Push(const T& value) override {
+            buffer_.push_back(value);
+            return true;
+        }
+        bool PushBatch(const T* values, size_t count) override {
+            buffer_.insert(buffer_.end(), values, values + count);
+            return true;
+        }
+        void Finish() override {
+            ArenaVector<size_t> order(buffer_.size());
+            std::iota(order.begin(), order.end(), size_t(0));
+            // Stable sorts from the least significant key up give the composite order
+            for (auto it = keys_.rbegin(); it != keys_.rend(); ++it) {
+                (*it)->Sort(buffer_, order);
+            }
+            for (size_t index : order) {
+                if (!this->downstream_.Push(buffer_[index])) break;
+            }
+            this->downstream_.Finish();
+        }
+    private:
+        const std::vector<std::shared_ptr<const SortKey<T>>>& keys_;
+        ArenaVector<T> buffer_;
+    };
+
+    class TopStage : public StageSink<T> {
+    public:
+        TopStage(Sink<T>& downstream, const std::vector<std::shared_ptr<const SortKey<T>>>& keys, size_t limit)
+            : StageSink<T>(downstream), limit_(limit), pruneAt_(limit < SIZE_MAX / 4 ? limit + std::max<size_t>(limit, 1024) : SIZE_MAX) {
+            for (const auto& key : keys) {
+                columns_.push_back(key->MakeColumn());
+            }
+        }
+        bool Push(const T& value) override {
+            if (limit_ == 0) return false;
+            for (auto& column : columns_) column->Append(value);
+            if (threshold_ != SIZE_MAX && !Before(buffer_.size(), threshold_)) {
+                for (auto& column : columns_) column->PopBack();
+                return true;
+            }
+            buffer_.push_back(value);
+            if (buffer_.size() >= pruneAt_) Prune();
+            return true;
+        }
+        void Finish() override {
+            if (buffer_.size() > limit_) Prune();
+            ArenaVector<size_t> order(buffer_.size());
+            std::iota(order.begin(), order.end(), size_t(0));
+            std::sort(order.begin(), order.end(), [this](size_t a, size_t b) { return Before(a, b); });
+            for (size_t index : order) {
+                if (!this->downstream_.Push(buffer_[index])) break;
+            }
+            this->downstream_.Finish();
+        }
+    private:
+        // Composite key order, ties going to the earlier candidate
+        bool Before(size_t a, size_t b) const {
+            for (const auto& column : columns_) {
+                const int result = column->Compare(a, b);
+                if (result != 0) return result < 0;
+            }
+            return a < b;
+        }
+
+        // Keep the limit_ best candidates in input order and remember the worst of them
+        void Prune() {
+            ArenaVector<size_t> order(buffer_.size());
+            std::iota(order.begin(), order.end(), size_t(0));
+            std::nth_element(order.begin(), order.begin() + limit_, order.end(), [this](size_t a, size_t b) { return Before(a, b); });
+            order.resize(limit_);
+            std::sort(order.begin(), order.end());
+            ArenaVector<T> kept;
+            kept.reserve(pruneAt_ == SIZE_MAX ? limit_ : pruneAt_);
+            for (size_t index : order) {
+                kept.push_back(std::move(buffer_[index]));
+            }
+            buffer_.swap(kept);
+            for (auto& column : columns_) column->Keep(order);
+            threshold_ = 0;
+            for (size_t i = 1; i < buffer_.size(); ++i) {
+                if (Before(threshold_, i)) threshold_ = i;
+            }
+        }
+
+        size_t limit_;
+        size_t pruneAt_;
+        size_t threshold_ = SIZE_MAX;
+        ArenaVector<ArenaPtr<KeyColumn<T>>> columns_;
+        ArenaVector<T> buffer_;
+    };
+
+    std::vector<std::shared_ptr<const SortKey<T>>> keys_;
+    size_t limit_;
+};
+
+// Lazy operation that buffers the whole input and rewrites it before passing it on
 template <typename T, typename Func>
-class CustomOperation : public LazyOperation<T> {
+class BarrierOperation : public LazyOperation<T> {
 public:
-    CustomOperation(Func operation) : operation_(operation) {}
-    void Apply(std::vector<T>& data) const override {
-        operation_(data);
+    BarrierOperation(Func operation) : operation_(operation) {}
+    ArenaPtr<Sink<T>> Wrap(Sink<T>& downstream) const override {
+        return ArenaNew<Stage>(downstream, operation_);
     }
+    OperationKind Kind() const override { return OperationKind::Barrier; }
+    std::string Describe() const override { return "Barrier"; }
 private:
+    class Stage : public StageSink<T> {
+    public:
+        Stage(Sink<T>& downstream, const Func& operation) : StageSink<T>(downstream), operation_(operation) {}
+        bool Push(const T& value) override {
+            buffer_.push_back(value);
+            return true;
+        }
+        bool PushBatch(const T* values, size_t count) override {
+            buffer_.insert(buffer_.end(), values, values + count);
+            return true;
+        }
+        void Finish() override {
+            operation_(buffer_);
+            for (const auto& value : buffer_) {
+                if (!this->downstream_.Push(value)) break;
+            }
+            this->downstream_.Finish();
+        }
+    private:
+        const Func& operation_;
+        ArenaVector<T> buffer_;
+    };
     Func operation_;
 };
 
+struct ReverseBuffer {
+    template <typename Buffer>
+    void operator()(Buffer& buffer) const { std::reverse(buffer.begin(), buffer.end()); }
+};
+
+// Lazy operation reversing the input
+template <typename T>
+class ReverseOperation : public BarrierOperation<T, ReverseBuffer> {
+public:
+    ReverseOperation() : BarrierOperation<T, ReverseBuffer>(ReverseBuffer()) {}
+    OperationKind Kind() const override { return OperationKind::Reverse; }
+    std::string Describe() const override { return "Reverse"; }
+};
+
+// Reverse followed by Take(count): keeps only the last count elements in a ring buffer and
+// emits them newest first, instead of buffering the whole input
+template <typename T>
+class ReverseTakeOperation : public LazyOperation<T> {
+public:
+    ReverseTakeOperation(size_t count) : count_(count) {}
+    ArenaPtr<Sink<T>> Wrap(Sink<T>& downstream) const override {
+        return ArenaNew<Stage>(downstream, count_);
+    }
+    OperationKind Kind() const override { return OperationKind::ReverseTake; }
+    std::string Describe() const override { return "ReverseTake(" + std::to_string(count_) + ")"; }
+    size_t Count() const { return count_; }
+private:
+    class Stage : public StageSink<T> {
+    public:
+        Stage(Sink<T>& downstream, size_t count) : StageSink<T>(downstream), count_(count) {}
+        bool Push(const T& value) override {
+            if (count_ == 0) return false;
+            if (ring_.size() < count_) {
+                ring_.push_back(value);
+            } else {
+                ring_[next_] = value;
+                next_ = next_ + 1 == count_ ? 0 : next_ + 1;
+            }
+            return true;
+        }
+        bool PushBatch(const T* values, size_t count) override {
+            if (count_ == 0) return false;
+            // Only the last count_ elements of a long batch can survive
+            const size_t skipped = count > count_ ? count - count_ : 0;
+            return Sink<T>::PushBatch(values + skipped, count - skipped);
+        }
+        void Finish() override {
+            for (size_t i = ring_.size(); i > 0; --i) {
+                if (!this->downstream_.Push(ring_[(next_ + i - 1) % ring_.size()])) break;
+            }
+            this->downstream_.Finish();
+        }
+    private:
+        size_t count_;
+        size_t next_ = 0;
+        ArenaVector<T> ring_;
+    };
+    size_t count_;
+};
+
+// Aggregators for Aggregate(Min(), Max(), ...), which computes them all in one traversal.
+// Each folds the elements of a chunk into a State<T>, and chunk states are combined in order
+struct AggregatorBase {};
+
+struct MinAggregator : AggregatorBase {
+    template <typename T> using State = std::optional<T>;
+    template <typename T> static State<T> Init() { return State<T>(); }
+    template <typename T> static void Fold(State<T>& min, const T& value) { if (!min || value < *min) min = value; }
+    template <typename T> static void Combine(State<T>& min, const State<T>& more) { if (more && (!min || *more < *min)) min = more; }
+    template <typename T> static T Finish(const State<T>& min) {
+        if (!min) throw std::logic_error("Empty range");
+        return *min;
+    }
+};
+
+struct MaxAggregator : AggregatorBase {
+    template <typename T> using State = std::optional<T>;
+    template <typename T> static State<T> Init() { return State<T>(); }
+    template <typename T> static void Fold(State<T>& max, const T& value) { if (!max || *max < value) max = value; }
+    template <typename T> static void Combine(State<T>& max, const State<T>& more) { if (more && (!max || *max < *more)) max = more; }
+    template <typename T> static T Finish(const State<T>& max) {
+        if (!max) throw std::logic_error("Empty range");
+        return *max;
+    }
+};
+
+struct SumAggregator : AggregatorBase {
+    template <typename T> using State = T;
+    template <typename T> static State<T> Init() { return T(0); }
+    template <typename T> static void Fold(State<T>& sum, const T& value) { sum = sum + value; }
+    template <typename T> static void Combine(State<T>& sum, const State<T>& more) { sum = sum + more; }
+    template <typename T> static T Finish(const State<T>& sum) { return sum; }
+};
+
+struct CountAggregator : AggregatorBase {
+    template <typename T> using State = size_t;
+    template <typename T> static State<T> Init() { return 0; }
+    template <typename T> static void Fold(State<T>& count, const T&) { ++count; }
+    template <typename T> static void Combine(State<T>& count, const State<T>& more) { count += more; }
+    template <typename T> static size_t Finish(const State<T>& count) { return count; }
+};
+
+struct AverageAggregator : AggregatorBase {
+    template <typename T> using State = std::pair<T, size_t>;
+    template <typename T> static State<T> Init() { return State<T>(T(0), 0); }
+    template <typename T> static void Fold(State<T>& partial, const T& value) { partial.first = partial.first + value; ++partial.second; }
+    template <typename T> static void Combine(State<T>& partial, const State<T>& more) { partial.first = partial.first + more.first; partial.second += more.second; }
+    template <typename T> static double Finish(const State<T>& partial) {
+        return partial.second == 0 ? 0.0 : static_cast<double>(partial.first) / partial.second;
+    }
+};
+
+inline MinAggregator Min() { return {}; }
+inline MaxAggregator Max() { return {}; }
+inline SumAggregator Sum() { return {}; }
+inline CountAggregator Count() { return {}; }
+inline AverageAggregator Average() { return {}; }
+
+template <typename... Aggregators>
+constexpr bool AreAggregators = sizeof...(Aggregators) > 0 && (std::is_base_of<AggregatorBase, Aggregators>::value && ...);
+
+template <typename Aggregator, typename T>
+using AggregatorState = typename Aggregator::template State<T>;
+
+template <typename Aggregator, typename T>
+using AggregatorResult = decltype(Aggregator::template Finish<T>(std::declval<const AggregatorState<Aggregator, T>&>()));
+
+// Per-aggregator states of one traversal
+template <typename T, typename... Aggregators>
+class AggregatorStates {
+public:
+    AggregatorStates() : states_(Aggregators::template Init<T>()...) {}
+
+    void Fold(const T& value) {
+        std::apply([&value](auto&... state) { (Aggregators::template Fold<T>(state, value), ...); }, states_);
+    }
+    void Combine(const AggregatorStates& more) { Combine(more, std::index_sequence_for<Aggregators...>()); }
+    const std::tuple<AggregatorState<Aggregators, T>...>& States() const { return states_; }
+    std::tuple<AggregatorResult<Aggregators, T>...> Finish() const {
+        return std::apply([](const auto&... state) {
+            return std::tuple<AggregatorResult<Aggregators, T>...>(Aggregators::template Finish<T>(state)...);
+        }, states_);
+    }
+
+private:
+    template <size_t... Is>
+    void Combine(const AggregatorStates& more, std::index_sequence<Is...>) {
+        (Aggregators::template Combine<T>(std::get<Is>(states_), std::get<Is>(more.states_)), ...);
+    }
+
+    std::tuple<AggregatorState<Aggregators, T>...> states_;
+};
+
+// Summary of a range computed in one traversal; min and max are value-initialized when count is 0
+template <typename T>
+struct RangeStats {
+    size_t count = 0;
+    T sum = T(0);
+    T min = T();
+    T max = T();
+    double average = 0;
+};
+
+// Operation of a range as it was written, kept for Explain; shared by the ranges derived from it
+struct PlanStep {
+    std::string description;
+    std::shared_ptr<const PlanStep> previous;
+};
+
+template <typename T>
+class MyRange;
+
+template <typename T, typename Producer>
+class Pipeline;
+
+template <typename T>
+class RangeProducer;
+
+// Producer feeding a range that is not backed by its own buffer
+template <typename T>
+class RangeSource {
+public:
+    virtual ~RangeSource() = default;
+    // Pushes elements into sink until it declines or the source is exhausted
+    virtual void Produce(Sink<T>& sink) const = 0;
+    // Sources that can be split report their root size and produce the elements of a slice of it
+    virtual bool IsPartitionable() const { return false; }
+    virtual size_t Size() const { return 0; }
+    virtual void ProduceSlice(Sink<T>& sink, size_t, size_t) const { Produce(sink); }
+    // Owner of the storage the elements refer into, such as the mapping of a file, or null.
+    // Ranges that buffer the elements keep it alive; sources over other ranges forward theirs
+    virtual std::shared_ptr<const void> Pin() const { return nullptr; }
+    // Buffer holding exactly the elements in order, for sources that keep them materialized
+    virtual std::shared_ptr<std::vector<T>> Buffer() const { return nullptr; }
+    // Number of elements when it can be had without producing them
+    virtual std::optional<size_t> Count() const { return std::nullopt; }
+    // Description for Explain, with nested ranges as written or as rewritten
+    virtual std::string Describe(bool) const { return "Source"; }
+};
+
+// Sink mapping elements through a selector into a sink of another element type, batch by batch
+template <typename Source, typename T, typename Func>
+class MapSink : public Sink<Source> {
+public:
+    MapSink(Sink<T>& downstream, const Func& selector) : downstream_(downstream), selector_(selector) {}
+    bool Push(const Source& value) override {
+        return downstream_.Push(selector_(value));
+    }
+    bool PushBatch(const Source* values, size_t count) override {
+        if (!IsBatchable<T>) return Sink<Source>::PushBatch(values, count);
+        for (size_t offset = 0; offset < count; offset += BatchSize) {
+            const size_t size = std::min(BatchSize, count - offset);
+            FillBatch(output_, size, [&](size_t i) { return selector_(values[offset + i]); });
+            if (!downstream_.PushBatch(BatchData(output_), size)) return false;
+        }
+        return true;
+    }
+private:
+    Sink<T>& downstream_;
+    const Func& selector_;
+    ArenaVector<T> output_;
+};
+
+// Source yielding the elements of another range mapped through a selector
+template <typename T, typename Source, typename Func>
+class SelectSource : public RangeSource<T> {
+public:
+    SelectSource(const MyRange<Source>& upstream, Func selector) : upstream_(upstream), selector_(selector) {}
+    void Produce(Sink<T>& sink) const override {
+        MapSink<Source, T, Func> adapter(sink, selector_);
+        upstream_.Run(adapter);
+    }
+    bool IsPartitionable() const override { return upstream_.IsPartitionable(); }
+    size_t Size() const override { return upstream_.SourceSize(); }
+    void ProduceSlice(Sink<T>& sink, size_t first, size_t last) const override {
+        MapSink<Source, T, Func> adapter(sink, selector_);
+        upstream_.Run(adapter, first, last);
+    }
+    // Counting skips the selector
+    std::optional<size_t> Count() const override { return upstream_.Count(); }
+    std::shared_ptr<const void> Pin() const override { return upstream_.Pin(); }
+    std::string Describe(bool asWritten) const override { return upstream_.Plan(asWritten) + " -> Select"; }
+private:
+    MyRange<Source> upstream_;
+    Func selector_;
+};
+
+// Lazy operation appending the elements of another range once the input is exhausted
+template <typename T>
+class ConcatOperation : public LazyOperation<T> {
+public:
+    ConcatOperation(const MyRange<T>& other) : other_(other) {}
+    ArenaPtr<Sink<T>> Wrap(Sink<T>& downstream) const override {
+        return ArenaNew<Stage>(downstream, other_);
+    }
+    OperationKind Kind() const override { return OperationKind::Concat; }
+    std::shared_ptr<const void> Pin() const override { return other_.Pin(); }
+    std::string Describe() const override { return "Concat(" + other_.Plan(false) + ")"; }
+private:
+    class Stage : public StageSink<T> {
+    public:
+        Stage(Sink<T>& downstream, const MyRange<T>& other) : StageSink<T>(downstream), other_(other) {}
+        bool Push(const T& value) override {
+            open_ = this->downstream_.Push(value);
+            return open_;
+        }
+        bool PushBatch(const T* values, size_t count) override {
+            open_ = this->downstream_.PushBatch(values, count);
+            return open_;
+        }
+        void Finish() override {
+            if (open_) {
+                auto forward = [this](const T& value) { return this->downstream_.Push(value); };
+                CallbackSink<T, decltype(forward)> adapter(forward);
+                other_.Run(adapter);
+            }
+            this->downstream_.Finish();
+        }
+    private:
+        const MyRange<T>& other_;
+        bool open_ = true;
+    };
+    MyRange<T> other_;
+};
+
+// Source yielding the elements of a vector computed by a callable each time it is produced.
+// pin returns the owner of what the generated elements refer into
+template <typename T, typename Func, typename PinFunc>
+class GeneratorSource : public RangeSource<T> {
+public:
+    GeneratorSource(Func generator, PinFunc pin) : generator_(generator), pin_(pin) {}
+    void Produce(Sink<T>& sink) const override {
+        for (const auto& value : generator_()) {
+            if (!sink.Push(value)) break;
+        }
+    }
+    std::shared_ptr<const void> Pin() const override { return pin_(); }
+    std::string Describe(bool) const override { return "Generated"; }
+private:
+    Func generator_;
+    PinFunc pin_;
+};
+
+// Source of a hash join. Elements of the inner range are bucketed by key and the outer range
+// is streamed through the buckets; when the outer range is the smaller one its keys are indexed
+// instead and only matching inner elements are kept. Either way results follow outer order,
+// and with Grouped every outer element yields one result with its (possibly empty) matches
+template <typename R, typename Outer, typename Inner, typename OuterKey, typename InnerKey, typename ResultSelector, bool Grouped>
+class JoinSource : public RangeSource<R> {
+public:
+    using KeyType = std::decay_t<decltype(std::declval<OuterKey&>()(std::declval<const Outer&>()))>;
+
+    JoinSource(const MyRange<Outer>& outer, const MyRange<Inner>& inner, OuterKey outerKey, InnerKey innerKey, ResultSelector resultSelector)
+        : outer_(outer), inner_(inner), outerKey_(outerKey), innerKey_(innerKey), resultSelector_(resultSelector) {}
+
+    void Produce(Sink<R>& sink) const override {
+        KeyIndex<KeyType> index;
+        ArenaVector<std::vector<Inner>> buckets;
+        if (outer_.SourceSize() < inner_.SourceSize()) {
+            ArenaVector<Outer> outers;
+            ArenaVector<size_t> ids;
+            outer_.ForEach([&](const Outer& outer) {
+                outers.push_back(outer);
+                ids.push_back(index.Insert(outerKey_(outer)).first);
+                return true;
+            });
+            buckets.resize(index.Size());
+            inner_.ForEach([&](const Inner& inner) {
+                if (const size_t* id = index.Find(innerKey_(inner))) buckets[*id].push_back(inner);
+                return true;
+            });
+            for (size_t i = 0; i < outers.size(); ++i) {
+                if (!Emit(sink, outers[i], &buckets[ids[i]])) break;
+            }
+        } else {
+            inner_.ForEach([&](const Inner& inner) {
+                auto slot = index.Insert(innerKey_(inner));
+                if (slot.second) buckets.emplace_back();
+                buckets[slot.first].push_back(inner);
+                return true;
+            });
+            outer_.ForEach([&](const Outer& outer) {
+                const size_t* id = index.Find(outerKey_(outer));
+                return Emit(sink, outer, id ? &buckets[*id] : nullptr);
+            });
+        }
+    }
+
+    // A group join yields one result per outer element
+    std::optional<size_t> Count() const override {
+        if (Grouped) return outer_.Count();
+        return std::nullopt;
+    }
+    std::shared_ptr<const void> Pin() const override { return CombinePins(outer_.Pin(), inner_.Pin()); }
+    std::string Describe(bool asWritten) const override {
+        return std::string(Grouped ? "GroupJoin(" : "Join(") + outer_.Plan(asWritten) + ", " + inner_.Plan(asWritten) + ")";
+    }
+
+private:
+    // Pushes the results for one outer element; returns false once the sink declines
+    bool Emit(Sink<R>& sink, const Outer& outer, const std::vector<Inner>* matches) const {
+        if constexpr (Grouped) {
+            static const std::vector<Inner> none;
+            return sink.Push(resultSelector_(outer, matches ? *matches : none));
+        } else {
+            if (!matches) return true;
+            for (const auto& inner : *matches) {
+                if (!sink.Push(resultSelector_(outer, inner))) return false;
+            }
+            return true;
+        }
+    }
+
+    MyRange<Outer> outer_;
+    MyRange<Inner> inner_;
+    OuterKey outerKey_;
+    InnerKey innerKey_;
+    ResultSelector resultSelector_;
+};
+
+// Source of Intersect and Except: distinct elements of the first range, in order, that are
+// (keep) or are not (!keep) in the second. The smaller range is indexed and the other streamed
+template <typename T>
+class SetFilterSource : public RangeSource<T> {
+public:
+    SetFilterSource(const MyRange<T>& first, const MyRange<T>& second, bool keep) : first_(first), second_(second), keep_(keep) {}
+
+    void Produce(Sink<T>& sink) const override {
+        KeyIndex<T> index;
+        if (first_.SourceSize() < second_.SourceSize()) {
+            ArenaVector<T> items;
+            ArenaVector<size_t> ids;
+            first_.ForEach([&](const T& value) {
+                items.push_back(value);
+                ids.push_back(index.Insert(value).first);
+                return true;
+            });
+            ArenaVector<char> found(index.Size(), 0);
+            size_t foundCount = 0;
+            second_.ForEach([&](const T& value) {
+                const size_t* id = index.Find(value);
+                if (id && !found[*id]) {
+                    found[*id] = 1;
+                    ++foundCount;
+                }
+                return foundCount < found.size();
+            });
+            ArenaVector<char> emitted(index.Size(), 0);
+            for (size_t i = 0; i < items.size(); ++i) {
+                if (emitted[ids[i]] || static_cast<bool>(found[ids[i]]) != keep_) continue;
+                emitted[ids[i]] = 1;
+                if (!sink.Push(items[i])) break;
+            }
+        } else {
+            second_.ForEach([&](const T& value) {
+                index.Insert(value);
+                return true;
+            });
+            DistinctSet<T> emitted;
+            first_.ForEach([&](const T& value) {
+                if ((index.Find(value) != nullptr) != keep_ || !emitted.Insert(value)) return true;
+                return sink.Push(value);
+            });
+        }
+    }
+
+    // Only elements of the first range are yielded, but the second may hold the same storage
+    std::shared_ptr<const void> Pin() const override { return CombinePins(first_.Pin(), second_.Pin()); }
+    std::string Describe(bool asWritten) const override {
+        return std::string(keep_ ? "Intersect(" : "Except(") + first_.Plan(asWritten) + ", " + second_.Plan(asWritten) + ")";
+    }
+
+private:
+    MyRange<T> first_;
+    MyRange<T> second_;
+    bool keep_;
+};
+
+// True when the container keeps its elements in one array that std::data exposes
+template <typename Container, typename = void>
+struct IsContiguousContainer : std::false_type {};
+
+template <typename Container>
+struct IsContiguousContainer<Container, std::void_t<decltype(std::data(std::declval<const Container&>()))>> : std::true_type {};
+
+// Source reading a container owned by the caller in place, each element through project. The
+// container must outlive every range over it. Contiguous storage is pushed in batches without
+// copying, and random-access containers can be split
+template <typename T, typename Container, typename Project>
+class ViewSource : public RangeSource<T> {
+public:
+    ViewSource(const Container& container, Project project) : container_(container), project_(project) {}
+    void Produce(Sink<T>& sink) const override { ProduceSlice(sink, 0, Size()); }
+    bool IsPartitionable() const override { return RandomAccess; }
+    size_t Size() const override { return std::size(container_); }
+    std::optional<size_t> Count() const override { return Size(); }
+    std::string Describe(bool) const override { return "View(" + std::to_string(Size()) + " elements)"; }
+    void ProduceSlice(Sink<T>& sink, size_t first, size_t last) const override {
+        last = std::min(last, Size());
+        if (first >= last) return;
+        if constexpr (InPlace) {
+            PushBatches(sink, std::data(container_) + first, last - first);
+        } else {
+            auto it = std::begin(container_);
+            std::advance(it, first);
+            if constexpr (IsBatchable<T>) {
+                ArenaVector<T> batch;
+                for (size_t offset = first; offset < last; offset += BatchSize) {
+                    const size_t size = std::min(BatchSize, last - offset);
+                    FillBatch(batch, size, [&](size_t) { return T(project_(*it++)); });
+                    if (!sink.PushBatch(batch.data(), size)) return;
+                }
+            } else {
+                for (size_t i = first; i < last; ++i, ++it) {
+                    if (!sink.Push(project_(*it))) return;
+                }
+            }
+        }
+    }
+private:
+    using Iterator = decltype(std::begin(std::declval<const Container&>()));
+    static constexpr bool RandomAccess = std::is_base_of<std::random_access_iterator_tag, typename std::iterator_traits<Iterator>::iterator_category>::value;
+    static constexpr bool InPlace = IsContiguousContainer<Container>::value && std::is_same<Project, IdentitySelector>::value;
+
+    const Container& container_;
+    Project project_;
+};
+
+// Source of Memoize: evaluates its range once, on first use, and shares the buffer with
+// every range derived from it
+template <typename T>
+class MemoSource : public RangeSource<T> {
+public:
+    explicit MemoSource(const MyRange<T>& range) : range_(range) {}
+
+    void Produce(Sink<T>& sink) const override { ProduceSlice(sink, 0, SIZE_MAX); }
+    bool IsPartitionable() const override { return true; }
+    size_t Size() const override { return Buffer()->size(); }
+    void ProduceSlice(Sink<T>& sink, size_t first, size_t last) const override { PushSlice(sink, *Buffer(), first, last); }
+    std::shared_ptr<const void> Pin() const override { Buffer(); return range_.pinned_; }
+    std::optional<size_t> Count() const override { return Buffer()->size(); }
+    std::string Describe(bool asWritten) const override { return "Memoize(" + range_.Plan(asWritten) + ")"; }
+
+    std::shared_ptr<std::vector<T>> Buffer() const override {
+        std::call_once(evaluated_, [this] {
+            range_.Evaluate();
+            if (!range_.data_) range_.data_ = std::make_shared<std::vector<T>>();
+        });
+        return range_.data_;
+    }
+
+private:
+    // Holds the prefix until evaluated, then the buffer and anything pinning its elements
+    mutable MyRange<T> range_;
+    mutable std::once_flag evaluated_;
+};
+
+template <typename T, typename KeySelector>
+class GroupedRange;
+
+template <typename... Fields>
+class ColumnRange;
+
+template <typename T>
+class LiveRange;
+
+class StringRange;
+
+template <typename T, typename State, typename Fold, typename Finish>
+class LiveAggregate;
+
 // Class representing a range of elements with lazy operations
 template <typename T>
 class MyRange {
 public:
     MyRange() = default;
 
-     explicit MyRange(std::vector<T>&& data) : data_(std::move(data)) {}
+    explicit MyRange(std::vector<T>&& data) : data_(std::make_shared<std::vector<T>>(std::move(data))) {}
 
     MyRange(const MyRange& other) = default;
     MyRange& operator=(const MyRange& other) = default;
 
-    // Constructor that moves data from various containers
-    explicit MyRange(std::vector<T>& data) : data_(std::move(data)) {}
-    explicit MyRange(std::list<T>& data) : data_(std::move(data)) {}
-    explicit MyRange(std::deque<T>& data) : data_(std::move(data)) {}
-    explicit MyRange(std::set<T>& data) : data_(std::move(data)) {}
+    // Constructors that copy data from various containers, or move it out of temporaries
+    explicit MyRange(const std::vector<T>& data) : data_(std::make_shared<std::vector<T>>(data)) {}
+    explicit MyRange(const std::list<T>& data) : data_(std::make_shared<std::vector<T>>(data.begin(), data.end())) {}
+    explicit MyRange(std::list<T>&& data) : data_(std::make_shared<std::vector<T>>(std::make_move_iterator(data.begin()), std::make_move_iterator(data.end()))) {}
+    explicit MyRange(const std::deque<T>& data) : data_(std::make_shared<std::vector<T>>(data.begin(), data.end())) {}
+    explicit MyRange(std::deque<T>&& data) : data_(std::make_shared<std::vector<T>>(std::make_move_iterator(data.begin()), std::make_move_iterator(data.end()))) {}
+    explicit MyRange(const std::set<T>& data) : data_(std::make_shared<std::vector<T>>(data.begin(), data.end())) {}
+
+    // Range reading the caller's container in place, without copying it; the container must
+    // outlive every range derived from this one
+    template <typename Container>
+    static MyRange<T> View(const Container& container);
+
+    // View of container whose elements are project(element), e.g. the values of a map
+    template <typename Container, typename Project>
+    static MyRange<T> View(const Container& container, Project project);
 
     // Constructor that takes an array
     template<size_t N>
-    MyRange(const T(&arr)[N]) : data_(arr, arr + N) {}
+    MyRange(const T(&arr)[N]) : data_(std::make_shared<std::vector<T>>(arr, arr + N)) {}
+
+    // Fixed-size binary records read in place from a memory-mapped file
+    static MyRange<T> FromMappedFile(const std::string& path);
+
+    // Lines of a memory-mapped text file without their line terminators, for
+    // MyRange<std::string_view>; the views stay valid while a range over the file exists
+    static MyRange<T> FromLines(const std::string& path);
+
+    // Minimum number of source elements before AsParallel splits work across threads
+    static constexpr size_t DefaultParallelThreshold = 1 << 15;
 
     // Iterator methods
-    typename std::vector<T>::iterator begin() { Evaluate(); return data_.begin(); }
-    typename std::vector<T>::const_iterator begin() const { const_cast<MyRange*>(this)->Evaluate(); return data_.begin(); }
-    typename std::vector<T>::iterator end() { Evaluate(); return data_.end(); }
-    typename std::vector<T>::const_iterator end() const { const_cast<MyRange*>(this)->Evaluate(); return data_.end(); }
+    // Mutable iteration detaches this range from a buffer shared with other ranges
+    typename std::vector<T>::iterator begin() { Evaluate(); return MutableData().begin(); }
+    typename std::vector<T>::const_iterator begin() const { Evaluate(); return Data().begin(); }
+    typename std::vector<T>::iterator end() { Evaluate(); return MutableData().end(); }
+    typename std::vector<T>::const_iterator end() const { Evaluate(); return Data().end(); }
 
     // Lazy operations
     template <typename Predicate>
@@ -103,26 +1362,91 @@ public:
     MyRange<T> Reverse() const;
     MyRange<T> Distinct() const;
 
+    // Evaluates this range at most once, when first needed, and shares the result with every
+    // range derived from the returned one instead of re-running the pending operations
+    MyRange<T> Memoize() const;
+    MyRange<T> Cache() const { return Memoize(); }
+
+    template <typename KeySelector>
+    MyRange<T> DistinctBy(KeySelector keySelector) const;
+
     template <typename KeySelector>
     auto OrderBy(KeySelector keySelector) const -> MyRange<T>;
 
     template <typename KeySelector>
-    auto GroupBy(KeySelector keySelector) const -> MyRange<std::pair<decltype(keySelector(std::declval<T>())), std::vector<T>>>;
+    MyRange<T> OrderByDescending(KeySelector keySelector) const;
+
+    // Secondary keys; the range must end in an ordering
+    template <typename KeySelector>
+    MyRange<T> ThenBy(KeySelector keySelector) const;
+
+    template <typename KeySelector>
+    MyRange<T> ThenByDescending(KeySelector keySelector) const;
+
+    // Hash joins, results in order of this (outer) range
+    template <typename Inner, typename OuterKey, typename InnerKey, typename ResultSelector>
+    auto Join(const MyRange<Inner>& inner, OuterKey outerKey, InnerKey innerKey, ResultSelector resultSelector) const
+        -> MyRange<std::decay_t<decltype(resultSelector(std::declval<const T&>(), std::declval<const Inner&>()))>>;
+
+    // Like Join, but resultSelector receives each outer element with the vector of its matches
+    template <typename Inner, typename OuterKey, typename InnerKey, typename ResultSelector>
+    auto GroupJoin(const MyRange<Inner>& inner, OuterKey outerKey, InnerKey innerKey, ResultSelector resultSelector) const
+        -> MyRange<std::decay_t<decltype(resultSelector(std::declval<const T&>(), std::declval<const std::vector<Inner>&>()))>>;
+
+    // Set operations yielding distinct elements in order of first appearance
+    MyRange<T> Intersect(const MyRange& other) const;
+    MyRange<T> Except(const MyRange& other) const;
+    MyRange<T> Union(const MyRange& other) const;
+
+    // Groups in order of first appearance of their key, either materialized or aggregated per key
+    template <typename KeySelector>
+    GroupedRange<T, KeySelector> GroupBy(KeySelector keySelector) const;
+
+    // Execution mode, inherited by ranges derived from this one
+    MyRange<T> AsParallel(size_t minParallelSize = DefaultParallelThreshold) const;
+    MyRange<T> AsSequential() const;
 
     // Immediate operations
-    bool All(std::function<bool(T)> predicate) const;
-    bool Any(std::function<bool(T)> predicate) const;
+    template <typename Predicate>
+    bool All(Predicate predicate) const;
+    template <typename Predicate>
+    bool Any(Predicate predicate) const;
     T Sum() const;
     double Average() const;
     T Min() const;
     T Max() const;
+    std::pair<T, T> MinMax() const;
     size_t Count() const;
     bool Contains(const T& value) const;
     T ElementAt(size_t index) const;
-    std::set<T> ToSet() const;
-    std::vector<T> ToList() const;
-    std::deque<T> ToDeque() const;
-    std::vector<T> ToVector() const;
+    T First() const;
+
+    // Several aggregates in one traversal, e.g. Aggregate(Min(), Max(), Average()), as a tuple
+    template <typename... Aggregators, typename = std::enable_if_t<AreAggregators<Aggregators...>>>
+    std::tuple<AggregatorResult<Aggregators, T>...> Aggregate(Aggregators... aggregators) const;
+
+    // Folds the elements as seed = func(seed, element), always sequentially
+    template <typename Seed, typename Func, typename = std::enable_if_t<!AreAggregators<Seed>>>
+    Seed Aggregate(Seed seed, Func func) const;
+
+    // Count, sum, min, max and average in one traversal
+    RangeStats<T> Stats() const;
+
+    // Element with the smallest or largest key, the first one on ties
+    template <typename KeySelector>
+    T MinBy(KeySelector keySelector) const;
+    template <typename KeySelector>
+    T MaxBy(KeySelector keySelector) const;
+
+    // On a temporary range the evaluated buffer is moved out when no other range shares it
+    std::set<T> ToSet() const&;
+    std::set<T> ToSet() &&;
+    std::vector<T> ToList() const&;
+    std::vector<T> ToList() &&;
+    std::deque<T> ToDeque() const&;
+    std::deque<T> ToDeque() &&;
+    std::vector<T> ToVector() const&;
+    std::vector<T> ToVector() &&;
 
     // Special methods for std::string
 
@@ -130,21 +1454,261 @@ public:
     MyRange<T> AddSuffix(const std::string& suffix) const;
     MyRange<T> ToUpperCase() const;
     MyRange<T> ToLowerCase() const;
+    // The strings copied into one contiguous buffer, for string work without an allocation each
+    StringRange ToStringRange() const;
+
+    // Statically typed view of this range whose operators inline into one loop
+    Pipeline<T, RangeProducer<T>> AsPipeline() const;
+
+    // The operations as written and as rewritten when they were added: adjacent Wheres fused
+    // and moved ahead of full sorts and of Distinct over integers and strings, Skips and Takes
+    // folded, Reverse pairs cancelled, Reverse then Take read from the tail, OrderBy then Take as
+    // a top-k selection
+    std::string Explain() const;
+
+    // Runs the query once and reports its plan, size and time; with LAIC_PROFILE also each
+    // operator's runs, elements in and out, own time and bytes allocated, and the number of
+    // evaluations and range and buffer copies so far. As text or as JSON
+    std::string ExplainAnalyze() const;
+    std::string ExplainAnalyzeJson() const;
 
 private:
-    mutable std::vector<T> data_;
+    template <typename U>
+    friend class MyRange;
+    template <typename U, typename Source, typename Func>
+    friend class SelectSource;
+    template <typename U, typename Producer>
+    friend class Pipeline;
+    friend class RangeProducer<T>;
+    friend class ConcatOperation<T>;
+    template <typename U, typename KeySelector>
+    friend class GroupedRange;
+    template <typename R, typename Outer, typename Inner, typename OuterKey, typename InnerKey, typename ResultSelector, bool Grouped>
+    friend class JoinSource;
+    friend class SetFilterSource<T>;
+    friend class MemoSource<T>;
+    template <typename... Fields>
+    friend class ColumnRange;
+    friend class LiveRange<T>;
+    template <typename U, typename State, typename Fold, typename Finish>
+    friend class LiveAggregate;
+    friend class StringRange;
+
+    // Source buffer shared copy-on-write between ranges derived from each other
+    mutable std::shared_ptr<std::vector<T>> data_;
     mutable std::vector<std::shared_ptr<LazyOperation<T>>> operations_;
+    mutable std::shared_ptr<const RangeSource<T>> source_;
+    // Owner kept alive after evaluation because the buffered elements refer into it
+    mutable std::shared_ptr<const void> pinned_;
+    // Operations as written, newest first
+    mutable std::shared_ptr<const PlanStep> written_;
+    bool parallel_ = false;
+    size_t parallelThreshold_ = DefaultParallelThreshold;
+#ifdef LAIC_PROFILE
+    RangeCopyCounter copies_;
+#endif
+
+    // Runs the query once to count its elements, collecting the statistics of ExplainAnalyze
+    QueryReport Analyze() const;
+
+    // Copy of this range with operation added through the plan rewrites
+    MyRange<T> WithOperation(std::shared_ptr<LazyOperation<T>> operation, std::string written = std::string()) const;
+
+    // Appends operation to operations, rewriting it against the operations before it
+    static void AddOperation(std::vector<std::shared_ptr<LazyOperation<T>>>& operations, std::shared_ptr<LazyOperation<T>> operation);
+
+    // The operations with those that cannot change the number of elements dropped, and
+    // bounded reorderings reduced to Take
+    static std::vector<std::shared_ptr<LazyOperation<T>>> CountPlan(std::vector<std::shared_ptr<LazyOperation<T>>> operations);
 
-    // Evaluate all pending operations
+    // Source and operations, as written or as rewritten
+    std::string Plan(bool asWritten) const;
+
+    // Stream every element through the pending operations into sink in a single pass of
+    // BatchSize batches, optionally restricted to the source positions [first, last)
+    void Run(Sink<T>& sink, size_t first = 0, size_t last = SIZE_MAX) const;
+
+    // Stream elements to a callable returning false to stop early
+    template <typename Func>
+    void ForEach(Func callback, size_t first = 0, size_t last = SIZE_MAX) const {
+        if (IsBuffered()) {
+            const auto& data = Data();
+            last = std::min(last, data.size());
+            for (size_t i = first; i < last; ++i) {
+                if (!callback(data[i])) break;
+            }
+            return;
+        }
+        CallbackSink<T, Func> sink(callback);
+        Run(sink, first, last);
+    }
+
+    // Number of elements in the root source that Run slices index into
+    size_t SourceSize() const {
+        return source_ ? source_->Size() : Data().size();
+    }
+
+    // True when the source can be split and every pending operation is elementwise
+    bool IsPartitionable() const {
+        if (source_ && !source_->IsPartitionable()) return false;
+        return std::all_of(operations_.begin(), operations_.end(), [](const auto& op) { return op->IsElementwise(); });
+    }
+
+    // True when the elements are exactly the contiguous source buffer
+    bool IsBuffered() const {
+        return operations_.empty() && !source_;
+    }
+
+    // Number of slices the source is split into: one unless the range runs in
+    // parallel mode over at least parallelThreshold_ partitionable source elements
+    size_t ChunkCount() const;
+
+    // Fold each chunk of the range into its own Result, in order
+    template <typename Result, typename Func>
+    std::vector<Result> FoldChunks(const Result& initial, Func func) const;
+
+    // Same, handing every batch that reaches the end of the chain to batchFunc(result, values, count)
+    template <typename Result, typename Func, typename BatchFunc>
+    std::vector<Result> FoldChunks(const Result& initial, Func func, BatchFunc batchFunc) const;
+
+    // Visit each chunk of the range with func, keeping no per-chunk state
+    template <typename Func>
+    void ForEachChunk(Func func) const;
+
+    // Append an ordering key, either starting a new ordering or extending the trailing one
+    template <typename KeySelector>
+    MyRange<T> AddSortKey(KeySelector keySelector, bool descending, bool thenBy) const;
+
+    // Ordering at the end of the pending operations, or null
+    std::shared_ptr<OrderOperation<T>> TrailingOrdering() const {
+        if (operations_.empty()) return nullptr;
+        return std::dynamic_pointer_cast<OrderOperation<T>>(operations_.back());
+    }
+
+    // Element with the best key under better(candidate, current), the first one on ties
+    template <typename KeySelector, typename Better>
+    T BestBy(KeySelector keySelector, Better better) const;
+
+    // Apply a kernel taking (pointer, count) to each chunk of a buffered range, in order
+    template <typename Kernel>
+    auto FoldBuffer(Kernel kernel) const -> std::vector<decltype(kernel(std::declval<const T*>(), size_t(0)))>;
+
+    const std::vector<T>& Data() const {
+        static const std::vector<T> empty;
+        return data_ ? *data_ : empty;
+    }
+
+    // True when no other range shares the buffer, so it may be moved out
+    bool OwnsBuffer() const { return data_ && data_.use_count() == 1; }
+
+    // Buffer owned by this range alone, copied first if it is shared
+    std::vector<T>& MutableData() {
+        if (!data_) {
+            data_ = std::make_shared<std::vector<T>>();
+        } else if (data_.use_count() > 1) {
+#ifdef LAIC_PROFILE
+            ++GlobalRangeCounters().bufferCopies;
+            GlobalRangeCounters().bytesCopied += data_->size() * sizeof(T);
+#endif
+            data_ = std::make_shared<std::vector<T>>(*data_);
+        }
+        return *data_;
+    }
+
+    // Owner of the storage the elements refer into: that of the buffer, the source and any
+    // range an operation reads from
+    std::shared_ptr<const void> Pin() const {
+        std::shared_ptr<const void> pin = pinned_;
+        if (source_) pin = CombinePins(std::move(pin), source_->Pin());
+        for (const auto& operation : operations_) pin = CombinePins(std::move(pin), operation->Pin());
+        return pin;
+    }
+
+    // Materialize the pending operations into a fresh buffer, leaving shared buffers untouched
     void Evaluate() const {
-        for (const auto& op : operations_) {
-            op->Apply(data_);
+        if (IsBuffered()) return;
+#ifdef LAIC_PROFILE
+        ++GlobalRangeCounters().evaluations;
+#endif
+        if (operations_.empty()) {
+            if (auto buffer = source_->Buffer()) {
+                pinned_ = Pin();
+                data_ = std::move(buffer);
+                written_.reset();
+                source_.reset();
+                return;
+            }
+        }
+        auto chunks = FoldChunks(std::vector<T>(), [](std::vector<T>& chunk, const T& value) {
+            chunk.push_back(value);
+            return true;
+        });
+        auto result = std::make_shared<std::vector<T>>(std::move(chunks.front()));
+        for (size_t i = 1; i < chunks.size(); ++i) {
+            result->insert(result->end(), chunks[i].begin(), chunks[i].end());
         }
+#ifdef LAIC_PROFILE
+        GlobalRangeCounters().elementsMaterialized += result->size();
+#endif
+        pinned_ = Pin();
+        data_ = std::move(result);
         operations_.clear();
+        written_.reset();
+        source_.reset();
     }
 };
 
+// Lazy grouping of a range by key. Converts to a range of (key, elements) groups, or folds
+// each group into one accumulator without keeping its elements
+template <typename T, typename KeySelector>
+class GroupedRange {
+public:
+    using KeyType = std::decay_t<decltype(std::declval<KeySelector&>()(std::declval<const T&>()))>;
+
+    GroupedRange(const MyRange<T>& source, KeySelector keySelector) : source_(source), keySelector_(keySelector) {}
+
+    MyRange<std::pair<KeyType, std::vector<T>>> ToRange() const;
+    operator MyRange<std::pair<KeyType, std::vector<T>>>() const { return ToRange(); }
+
+    // Per-group aggregates, lazy ranges of (key, result) in order of first appearance
+    MyRange<std::pair<KeyType, size_t>> Count() const;
+
+    template <typename Selector>
+    auto Sum(Selector selector) const -> MyRange<std::pair<KeyType, std::decay_t<decltype(selector(std::declval<const T&>()))>>>;
+
+    template <typename Selector>
+    MyRange<std::pair<KeyType, double>> Average(Selector selector) const;
+
+    template <typename Selector>
+    auto Min(Selector selector) const -> MyRange<std::pair<KeyType, std::decay_t<decltype(selector(std::declval<const T&>()))>>>;
+
+    template <typename Selector>
+    auto Max(Selector selector) const -> MyRange<std::pair<KeyType, std::decay_t<decltype(selector(std::declval<const T&>()))>>>;
+
+    // Folds each group as seed = func(seed, element), always sequentially
+    template <typename Seed, typename Func>
+    MyRange<std::pair<KeyType, Seed>> Aggregate(Seed seed, Func func) const;
+
+private:
+    // Fold every element into the accumulator of its key; chunks folded in parallel are
+    // merged in order with combine, which keeps keys in order of first appearance
+    template <typename Acc, typename Fold, typename Combine>
+    ArenaVector<std::pair<KeyType, Acc>> FoldGroups(const Acc& initial, Fold fold, Combine combine) const;
+
+    // Range whose elements are computed by generator when it is evaluated
+    template <typename U, typename Generator>
+    MyRange<U> Defer(Generator generator) const;
+
+    MyRange<T> source_;
+    KeySelector keySelector_;
+};
+
 #include "laic_impl.h"
+#include "laic_pipeline.h"
+#include "laic_columns.h"
+#include "laic_file.h"
+#include "laic_live.h"
+#include "laic_strings.h"
 
 // Overloaded output operator for MyRange
 template <typename T>
@@ -0,0 +1,700 @@
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <new>
+#include <sstream>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+#include <malloc.h>
+#include <sys/resource.h>
+#if __has_include(<ranges>)
+#include <ranges>
+#endif
+#include "laic.h"
+
+// Benchmarks of the MyRange operators against hand-written loops and, when the standard library
+// has them, std::ranges views. Each benchmark reports ns/element, heap allocations and bytes
+// per run and the peak resident set size so far. With --check it reruns the benchmarks named
+// in a baseline file and fails when MyRange has slowed down relative to the hand loop
+
+#if defined(__cpp_lib_ranges)
+#define LAIC_BENCH_RANGES 1
+#else
+#define LAIC_BENCH_RANGES 0
+#endif
+
+// Heap usage counted by the replaced global allocation functions below
+static std::atomic<uint64_t> allocationCount{0};
+static std::atomic<uint64_t> allocationBytes{0};
+
+void* operator new(size_t size) {
+    ++allocationCount;
+    allocationBytes += size;
+    if (void* pointer = std::malloc(size ? size : 1)) return pointer;
+    throw std::bad_alloc();
+}
+
+void* operator new(size_t size, std::align_val_t alignment) {
+    ++allocationCount;
+    allocationBytes += size;
+    const size_t align = static_cast<size_t>(alignment);
+    if (void* pointer = std::aligned_alloc(align, (size + align - 1) / align * align)) return pointer;
+    throw std::bad_alloc();
+}
+
+// Every delete frees through the unsized one, the only place free is called. It is kept out of
+// line so that callers see delete paired with new rather than free paired with new
+__attribute__((noinline)) void operator delete(void* pointer) noexcept { std::free(pointer); }
+void operator delete(void* pointer, size_t) noexcept { ::operator delete(pointer); }
+void operator delete(void* pointer, std::align_val_t) noexcept { ::operator delete(pointer); }
+void operator delete(void* pointer, size_t, std::align_val_t) noexcept { ::operator delete(pointer); }
+
+// Keeps the compiler from discarding a result it can prove unused
+template <typename T>
+inline void Consume(const T& value) {
+    asm volatile("" : : "r"(&value) : "memory");
+}
+
+enum Variant { Laic, Loop, Ranges, VariantCount };
+
+const char* const VariantNames[VariantCount] = {"MyRange", "loop", "ranges"};
+
+// One benchmark at one size: a run of each variant over the same input, empty when missing
+struct Case {
+    std::function<void()> run[VariantCount];
+};
+
+struct Benchmark {
+    std::string name;
+    std::function<Case(size_t)> setup;
+};
+
+// Measurement of one variant
+struct Measurement {
+    double nsPerElement = 0;
+    double allocations = 0;
+    double bytes = 0;
+    long peakRssKb = 0;
+};
+
+struct Options {
+    std::string filter;
+    std::vector<size_t> sizes;
+    int repetitions = 5;
+    double minSampleMs = 2;
+    std::string checkFile;
+    std::string baselineFile;
+    double threshold = 2.0;
+};
+
+// Deterministic pseudo-random input
+class Generator {
+public:
+    explicit Generator(uint64_t seed) : state_(seed * 0x9E3779B97F4A7C15ull + 1) {}
+    uint64_t Next() {
+        state_ ^= state_ << 13;
+        state_ ^= state_ >> 7;
+        state_ ^= state_ << 17;
+        return state_;
+    }
+private:
+    uint64_t state_;
+};
+
+std::vector<int> RandomInts(size_t size, int bound) {
+    Generator generator(size);
+    std::vector<int> values(size);
+    for (auto& value : values) value = static_cast<int>(generator.Next() % static_cast<uint64_t>(bound));
+    return values;
+}
+
+std::vector<double> RandomDoubles(size_t size) {
+    Generator generator(size + 1);
+    std::vector<double> values(size);
+    for (auto& value : values) value = static_cast<double>(generator.Next() % 1000000) / 100.0;
+    return values;
+}
+
+std::vector<std::string> RandomStrings(size_t size) {
+    Generator generator(size + 2);
+    std::vector<std::string> values(size);
+    for (auto& value : values) value = "item" + std::to_string(generator.Next() % (size + 1));
+    return values;
+}
+
+struct Order {
+    int id;
+    int customer;
+    double amount;
+};
+
+std::vector<Order> RandomOrders(size_t size) {
+    Generator generator(size + 3);
+    std::vector<Order> orders(size);
+    for (size_t i = 0; i < size; ++i) {
+        orders[i] = Order{static_cast<int>(i), static_cast<int>(generator.Next() % 1000), static_cast<double>(generator.Next() % 100000) / 100.0};
+    }
+    return orders;
+}
+
+int IntBound(size_t size) { return static_cast<int>(std::min<size_t>(size, INT_MAX)); }
+
+// Benchmarks of one element type sharing an input; each entry becomes a Case
+template <typename T>
+Benchmark Make(const std::string& name, std::function<std::vector<T>(size_t)> input,
+               std::function<void(const MyRange<T>&)> laic, std::function<void(const std::vector<T>&)> loop,
+               std::function<void(const std::vector<T>&)> ranges = nullptr) {
+    return Benchmark{name, [=](size_t size) {
+        auto data = std::make_shared<std::vector<T>>(input(size));
+        auto range = std::make_shared<MyRange<T>>(std::vector<T>(*data));
+        Case result;
+        result.run[Laic] = [=] { laic(*range); };
+        result.run[Loop] = [=] { loop(*data); };
+        if (ranges) result.run[Ranges] = [=] { ranges(*data); };
+        return result;
+    }};
+}
+
+std::vector<Benchmark> Benchmarks() {
+    using Ints = std::vector<int>;
+    using Doubles = std::vector<double>;
+    using Strings = std::vector<std::string>;
+    auto ints = [](size_t size) { return RandomInts(size, IntBound(size)); };
+    auto keys = [](size_t size) { return RandomInts(size, 1000); };
+    // Small enough that sums of 100M elements fit in an int
+    auto digits = [](size_t size) { return RandomInts(size, 16); };
+    std::function<Doubles(size_t)> doubles = RandomDoubles;
+    std::function<Strings(size_t)> strings = RandomStrings;
+    std::function<std::vector<Order>(size_t)> orders = RandomOrders;
+    std::vector<Benchmark> benchmarks;
+
+    benchmarks.push_back(Make<int>("Where/int", ints,
+        [](const MyRange<int>& r) { Consume(r.Where([](int x) { return x % 3 == 0; }).ToVector()); },
+        [](const Ints& v) {
+            Ints result;
+            for (int x : v) if (x % 3 == 0) result.push_back(x);
+            Consume(result);
+        }
+#if LAIC_BENCH_RANGES
+        , [](const Ints& v) {
+            auto view = v | std::views::filter([](int x) { return x % 3 == 0; });
+            Consume(Ints(view.begin(), view.end()));
+        }
+#endif
+        ));
+    benchmarks.push_back(Make<double>("Where/double", doubles,
+        [](const MyRange<double>& r) { Consume(r.Where([](double x) { return x < 2500.0; }).ToVector()); },
+        [](const Doubles& v) {
+            Doubles result;
+            for (double x : v) if (x < 2500.0) result.push_back(x);
+            Consume(result);
+        }
+#if LAIC_BENCH_RANGES
+        , [](const Doubles& v) {
+            auto view = v | std::views::filter([](double x) { return x < 2500.0; });
+            Consume(Doubles(view.begin(), view.end()));
+        }
+#endif
+        ));
+    benchmarks.push_back(Make<std::string>("Where/string", strings,
+        [](const MyRange<std::string>& r) { Consume(r.Where([](const std::string& s) { return s.back() == '7'; }).ToVector()); },
+        [](const Strings& v) {
+            Strings result;
+            for (const auto& s : v) if (s.back() == '7') result.push_back(s);
+            Consume(result);
+        }
+#if LAIC_BENCH_RANGES
+        , [](const Strings& v) {
+            auto view = v | std::views::filter([](const std::string& s) { return s.back() == '7'; });
+            Consume(Strings(view.begin(), view.end()));
+        }
+#endif
+        ));
+    benchmarks.push_back(Make<int>("Select/int", ints,
+        [](const MyRange<int>& r) { Consume(r.Select([](int x) { return x * 2 + 1; }).ToVector()); },
+        [](const Ints& v) {
+            Ints result;
+            result.reserve(v.size());
+            for (int x : v) result.push_back(x * 2 + 1);
+            Consume(result);
+        }
+#if LAIC_BENCH_RANGES
+        , [](const Ints& v) {
+            auto view = v | std::views::transform([](int x) { return x * 2 + 1; });
+            Consume(Ints(view.begin(), view.end()));
+        }
+#endif
+        ));
+    benchmarks.push_back(Make<double>("Select/double", doubles,
+        [](const MyRange<double>& r) { Consume(r.Select([](double x) { return x * 1.2 + 3.0; }).ToVector()); },
+        [](const Doubles& v) {
+            Doubles result;
+            result.reserve(v.size());
+            for (double x : v) result.push_back(x * 1.2 + 3.0);
+            Consume(result);
+        }
+#if LAIC_BENCH_RANGES
+        , [](const Doubles& v) {
+            auto view = v | std::views::transform([](double x) { return x * 1.2 + 3.0; });
+            Consume(Doubles(view.begin(), view.end()));
+        }
+#endif
+        ));
+    benchmarks.push_back(Make<int>("WhereSelectSum/int", digits,
+        [](const MyRange<int>& r) { Consume(r.Where([](int x) { return x % 2 == 0; }).Select([](int x) { return x / 2; }).Sum()); },
+        [](const Ints& v) {
+            int sum = 0;
+            for (int x : v) if (x % 2 == 0) sum += x / 2;
+            Consume(sum);
+        }
+#if LAIC_BENCH_RANGES
+        , [](const Ints& v) {
+            int sum = 0;
+            for (int x : v | std::views::filter([](int x) { return x % 2 == 0; }) | std::views::transform([](int x) { return x / 2; })) sum += x;
+            Consume(sum);
+        }
+#endif
+        ));
+    benchmarks.push_back(Make<int>("OrderBy/int", ints,
+        [](const MyRange<int>& r) { Consume(r.OrderBy([](int x) { return x; }).ToVector()); },
+        [](const Ints& v) {
+            Ints result(v);
+            std::stable_sort(result.begin(), result.end());
+            Consume(result);
+        }
+#if LAIC_BENCH_RANGES
+        , [](const Ints& v) {
+            Ints result(v);
+            std::ranges::stable_sort(result);
+            Consume(result);
+        }
+#endif
+        ));
+    benchmarks.push_back(Make<double>("OrderBy/double", doubles,
+        [](const MyRange<double>& r) { Consume(r.OrderByDescending([](double x) { return x; }).ToVector()); },
+        [](const Doubles& v) {
+            Doubles result(v);
+            std::stable_sort(result.begin(), result.end(), std::greater<double>());
+            Consume(result);
+        }
+#if LAIC_BENCH_RANGES
+        , [](const Doubles& v) {
+            Doubles result(v);
+            std::ranges::stable_sort(result, std::ranges::greater());
+            Consume(result);
+        }
+#endif
+        ));
+    benchmarks.push_back(Make<std::string>("OrderBy/string", strings,
+        [](const MyRange<std::string>& r) { Consume(r.OrderBy([](const std::string& s) { return s; }).ToVector()); },
+        [](const Strings& v) {
+            Strings result(v);
+            std::stable_sort(result.begin(), result.end());
+            Consume(result);
+        }
+#if LAIC_BENCH_RANGES
+        , [](const Strings& v) {
+            Strings result(v);
+            std::ranges::stable_sort(result);
+            Consume(result);
+        }
+#endif
+        ));
+    benchmarks.push_back(Make<int>("OrderByTake/int", ints,
+        [](const MyRange<int>& r) { Consume(r.OrderBy([](int x) { return x; }).Take(10).ToVector()); },
+        [](const Ints& v) {
+            Ints result(v);
+            const size_t count = std::min<size_t>(10, result.size());
+            std::partial_sort(result.begin(), result.begin() + count, result.end());
+            result.resize(count);
+            Consume(result);
+        }
+#if LAIC_BENCH_RANGES
+        , [](const Ints& v) {
+            Ints result(std::min<size_t>(10, v.size()));
+            std::ranges::partial_sort_copy(v, result);
+            Consume(result);
+        }
+#endif
+        ));
+    benchmarks.push_back(Make<int>("GroupByCount/int", keys,
+        [](const MyRange<int>& r) { Consume(r.GroupBy([](int x) { return x % 1000; }).Count().ToVector()); },
+        [](const Ints& v) {
+            std::unordered_map<int, size_t> index;
+            std::vector<std::pair<int, size_t>> groups;
+            for (int x : v) {
+                auto slot = index.emplace(x % 1000, groups.size());
+                if (slot.second) groups.emplace_back(x % 1000, 0);
+                ++groups[slot.first->second].second;
+            }
+            Consume(groups);
+        }));
+    benchmarks.push_back(Make<Order>("GroupBySum/record", orders,
+        [](const MyRange<Order>& r) {
+            Consume(r.Where([](const Order& o) { return o.amount > 100.0; })
+                     .GroupBy([](const Order& o) { return o.customer; })
+                     .Sum([](const Order& o) { return o.amount; }).ToVector());
+        },
+        [](const std::vector<Order>& v) {
+            std::unordered_map<int, size_t> index;
+            std::vector<std::pair<int, double>> groups;
+            for (const auto& o : v) {
+                if (o.amount <= 100.0) continue;
+                auto slot = index.emplace(o.customer, groups.size());
+                if (slot.second) groups.emplace_back(o.customer, 0.0);
+                groups[slot.first->second].second += o.amount;
+            }
+            Consume(groups);
+        }));
+    benchmarks.push_back(Make<int>("Distinct/int", ints,
+        [](const MyRange<int>& r) { Consume(r.Distinct().ToVector()); },
+        [](const Ints& v) {
+            std::unordered_set<int> seen;
+            Ints result;
+            for (int x : v) if (seen.insert(x).second) result.push_back(x);
+            Consume(result);
+        }));
+    benchmarks.push_back(Make<std::string>("Distinct/string", strings,
+        [](const MyRange<std::string>& r) { Consume(r.Distinct().ToVector()); },
+        [](const Strings& v) {
+            std::unordered_set<std::string> seen;
+            Strings result;
+            for (const auto& s : v) if (seen.insert(s).second) result.push_back(s);
+            Consume(result);
+        }));
+    benchmarks.push_back(Make<int>("Concat/int", ints,
+        [](const MyRange<int>& r) { Consume(r.Concat(r).ToVector()); },
+        [](const Ints& v) {
+            Ints result;
+            result.reserve(v.size() * 2);
+            result.insert(result.end(), v.begin(), v.end());
+            result.insert(result.end(), v.begin(), v.end());
+            Consume(result);
+        }));
+    benchmarks.push_back(Make<int>("Reverse/int", ints,
+        [](const MyRange<int>& r) { Consume(r.Reverse().ToVector()); },
+        [](const Ints& v) { Consume(Ints(v.rbegin(), v.rend())); }
+#if LAIC_BENCH_RANGES
+        , [](const Ints& v) {
+            auto view = v | std::views::reverse;
+            Consume(Ints(view.begin(), view.end()));
+        }
+#endif
+        ));
+    benchmarks.push_back(Make<int>("SkipTake/int", ints,
+        [](const MyRange<int>& r) { Consume(r.Skip(r.Count() / 4).Take(r.Count() / 2).ToVector()); },
+        [](const Ints& v) { Consume(Ints(v.begin() + v.size() / 4, v.begin() + v.size() / 4 + v.size() / 2)); }
+#if LAIC_BENCH_RANGES
+        , [](const Ints& v) {
+            auto view = v | std::views::drop(v.size() / 4) | std::views::take(v.size() / 2);
+            Consume(Ints(view.begin(), view.end()));
+        }
+#endif
+        ));
+    benchmarks.push_back(Make<int>("Sum/int", digits,
+        [](const MyRange<int>& r) { Consume(r.Sum()); },
+        [](const Ints& v) {
+            int sum = 0;
+            for (int x : v) sum += x;
+            Consume(sum);
+        }));
+    benchmarks.push_back(Make<double>("Sum/double", doubles,
+        [](const MyRange<double>& r) { Consume(r.Sum()); },
+        [](const Doubles& v) {
+            double sum = 0;
+            for (double x : v) sum += x;
+            Consume(sum);
+        }));
+    benchmarks.push_back(Make<int>("Min/int", ints,
+        [](const MyRange<int>& r) { Consume(r.Min()); },
+        [](const Ints& v) {
+            int min = v.front();
+            for (int x : v) min = x < min ? x : min;
+            Consume(min);
+        }
+#if LAIC_BENCH_RANGES
+        , [](const Ints& v) { Consume(std::ranges::min(v)); }
+#endif
+        ));
+    benchmarks.push_back(Make<double>("Max/double", doubles,
+        [](const MyRange<double>& r) { Consume(r.Max()); },
+        [](const Doubles& v) {
+            double max = v.front();
+            for (double x : v) max = max < x ? x : max;
+            Consume(max);
+        }
+#if LAIC_BENCH_RANGES
+        , [](const Doubles& v) { Consume(std::ranges::max(v)); }
+#endif
+        ));
+    benchmarks.push_back(Make<double>("Average/double", doubles,
+        [](const MyRange<double>& r) { Consume(r.Average()); },
+        [](const Doubles& v) {
+            double sum = 0;
+            for (double x : v) sum += x;
+            Consume(sum / v.size());
+        }));
+    benchmarks.push_back(Make<int>("Count/int", ints,
+        [](const MyRange<int>& r) { Consume(r.Where([](int x) { return x % 5 == 0; }).Count()); },
+        [](const Ints& v) {
+            size_t count = 0;
+            for (int x : v) count += x % 5 == 0;
+            Consume(count);
+        }
+#if LAIC_BENCH_RANGES
+        , [](const Ints& v) { Consume(std::ranges::count_if(v, [](int x) { return x % 5 == 0; })); }
+#endif
+        ));
+    benchmarks.push_back(Make<double>("Aggregate/double", doubles,
+        [](const MyRange<double>& r) { Consume(r.Aggregate(Min(), Max(), Average(), Count())); },
+        [](const Doubles& v) {
+            double min = v.front(), max = v.front(), sum = 0;
+            for (double x : v) {
+                min = x < min ? x : min;
+                max = max < x ? x : max;
+                sum += x;
+            }
+            Consume(std::make_tuple(min, max, sum / v.size(), v.size()));
+        }));
+    auto upperLoop = [](const Strings& v) {
+        Strings result;
+        result.reserve(v.size());
+        for (const auto& s : v) {
+            std::string upper(s);
+            for (char& c : upper) c = static_cast<char>(std::toupper(static_cast<unsigned char>(c)));
+            result.push_back(std::move(upper));
+        }
+        Consume(result);
+    };
+    auto prefixLoop = [](const Strings& v) {
+        Strings result;
+        result.reserve(v.size());
+        for (const auto& s : v) result.push_back("key-" + s);
+        Consume(result);
+    };
+    benchmarks.push_back(Make<std::string>("ToUpperCase/string", strings,
+        [](const MyRange<std::string>& r) { Consume(r.ToUpperCase().ToVector()); },
+        upperLoop));
+    benchmarks.push_back(Make<std::string>("AddPrefix/string", strings,
+        [](const MyRange<std::string>& r) { Consume(r.AddPrefix("key-").ToVector()); },
+        prefixLoop
+#if LAIC_BENCH_RANGES
+        , [](const Strings& v) {
+            auto view = v | std::views::transform([](const std::string& s) { return "key-" + s; });
+            Consume(Strings(view.begin(), view.end()));
+        }
+#endif
+        ));
+    // The same string work on a StringRange, whose strings share one buffer
+    auto arena = [strings](const std::string& name, std::function<void(const StringRange&)> laic, std::function<void(const Strings&)> loop) {
+        return Benchmark{name, [=](size_t size) {
+            auto data = std::make_shared<Strings>(strings(size));
+            auto range = std::make_shared<StringRange>(*data);
+            Case result;
+            result.run[Laic] = [=] { laic(*range); };
+            result.run[Loop] = [=] { loop(*data); };
+            return result;
+        }};
+    };
+    benchmarks.push_back(arena("ToUpperCase/arena", [](const StringRange& r) { Consume(r.ToUpperCase().Arena().chars); }, upperLoop));
+    benchmarks.push_back(arena("AddPrefix/arena", [](const StringRange& r) { Consume(r.AddPrefix("key-").Arena().chars); }, prefixLoop));
+    return benchmarks;
+}
+
+long PeakRssKb() {
+    rusage usage{};
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_maxrss;
+}
+
+// Best time per element over the samples, each sample repeating run until it takes at least
+// minSampleMs so that small inputs are timed over many runs
+Measurement Measure(const std::function<void()>& run, size_t size, const Options& options) {
+    using Clock = std::chrono::steady_clock;
+    Measurement measurement;
+    const uint64_t allocationsBefore = allocationCount;
+    const uint64_t bytesBefore = allocationBytes;
+    run();
+    measurement.allocations = static_cast<double>(allocationCount - allocationsBefore);
+    measurement.bytes = static_cast<double>(allocationBytes - bytesBefore);
+
+    size_t iterations = 1;
+    double best = 0;
+    for (int sample = 0; sample < options.repetitions;) {
+        const auto start = Clock::now();
+        for (size_t i = 0; i < iterations; ++i) run();
+        const double ms = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+        if (ms < options.minSampleMs && iterations < (size_t(1) << 30)) {
+            iterations *= 2;
+            continue;
+        }
+        const double ns = ms * 1e6 / static_cast<double>(iterations) / static_cast<double>(std::max<size_t>(size, 1));
+        if (sample == 0 || ns < best) best = ns;
+        ++sample;
+    }
+    measurement.nsPerElement = best;
+    measurement.peakRssKb = PeakRssKb();
+    return measurement;
+}
+
+// Sizes such as 1000, 100K or 10M
+size_t ParseSize(const std::string& text) {
+    size_t end = 0;
+    double value = std::stod(text, &end);
+    const std::string suffix = text.substr(end);
+    if (suffix == "K" || suffix == "k") value *= 1e3;
+    else if (suffix == "M" || suffix == "m") value *= 1e6;
+    else if (!suffix.empty()) throw std::invalid_argument("Bad size " + text);
+    return static_cast<size_t>(value);
+}
+
+std::string FormatSize(size_t size) {
+    if (size >= 1000000 && size % 1000000 == 0) return std::to_string(size / 1000000) + "M";
+    if (size >= 1000 && size % 1000 == 0) return std::to_string(size / 1000) + "K";
+    return std::to_string(size);
+}
+
+// Ratio of the MyRange time to the hand loop time, the tracked regression metric
+double Slowdown(const Benchmark& benchmark, size_t size, const Options& options) {
+    Case c = benchmark.setup(size);
+    const double laic = Measure(c.run[Laic], size, options).nsPerElement;
+    const double loop = Measure(c.run[Loop], size, options).nsPerElement;
+    return laic / std::max(loop, 1e-6);
+}
+
+int RunAll(const std::vector<Benchmark>& benchmarks, const Options& options) {
+    std::printf("%-22s %6s %-8s %10s %10s %12s %10s %10s\n", "Benchmark", "Size", "Variant", "ns/elem", "allocs", "bytes", "vs loop", "peak MB");
+    for (const auto& benchmark : benchmarks) {
+        for (size_t size : options.sizes) {
+            Case c = benchmark.setup(size);
+            double loop = 0;
+            for (int variant : {Loop, Laic, Ranges}) {
+                if (!c.run[variant]) continue;
+                Measurement m = Measure(c.run[variant], size, options);
+                if (variant == Loop) loop = m.nsPerElement;
+                std::printf("%-22s %6s %-8s %10.3f %10.0f %12.0f %9.2fx %10.1f\n", benchmark.name.c_str(), FormatSize(size).c_str(), VariantNames[variant],
+                            m.nsPerElement, m.allocations, m.bytes, m.nsPerElement / std::max(loop, 1e-6), m.peakRssKb / 1024.0);
+                std::fflush(stdout);
+            }
+        }
+    }
+    return 0;
+}
+
+// Baseline file lines are "name size slowdown"; blank lines and lines from # are ignored
+int WriteBaseline(const std::vector<Benchmark>& benchmarks, const Options& options) {
+    std::ofstream out(options.baselineFile);
+    if (!out) {
+        std::fprintf(stderr, "Cannot write %s\n", options.baselineFile.c_str());
+        return 1;
+    }
+    out << "# MyRange time / hand loop time, checked by laic_bench --check\n";
+    for (const auto& benchmark : benchmarks) {
+        for (size_t size : options.sizes) {
+            const double slowdown = Slowdown(benchmark, size, options);
+            char line[128];
+            std::snprintf(line, sizeof(line), "%s %s %.3f\n", benchmark.name.c_str(), FormatSize(size).c_str(), slowdown);
+            out << line;
+            std::fputs(line, stdout);
+        }
+    }
+    return 0;
+}
+
+int Check(const std::vector<Benchmark>& benchmarks, const Options& options) {
+    std::ifstream in(options.checkFile);
+    if (!in) {
+        std::fprintf(stderr, "Cannot read %s\n", options.checkFile.c_str());
+        return 1;
+    }
+    int failures = 0;
+    std::string line;
+    while (std::getline(in, line)) {
+        if (line.empty() || line[0] == '#') continue;
+        std::istringstream fields(line);
+        std::string name, size;
+        double expected = 0;
+        if (!(fields >> name >> size >> expected)) {
+            std::fprintf(stderr, "Bad baseline line: %s\n", line.c_str());
+            ++failures;
+            continue;
+        }
+        auto benchmark = std::find_if(benchmarks.begin(), benchmarks.end(), [&](const Benchmark& b) { return b.name == name; });
+        if (benchmark == benchmarks.end()) {
+            std::fprintf(stderr, "Unknown benchmark %s\n", name.c_str());
+            ++failures;
+            continue;
+        }
+        if (!options.filter.empty() && name.find(options.filter) == std::string::npos) continue;
+        const double slowdown = Slowdown(*benchmark, ParseSize(size), options);
+        const bool regressed = slowdown > expected * options.threshold;
+        std::printf("%-22s %6s %8.3fx baseline %8.3fx %s\n", name.c_str(), size.c_str(), slowdown, expected, regressed ? "REGRESSED" : "ok");
+        if (regressed) ++failures;
+    }
+    if (failures > 0) std::printf("%d benchmark(s) failed against %s\n", failures, options.checkFile.c_str());
+    return failures > 0 ? 1 : 0;
+}
+
+void Usage() {
+    std::fprintf(stderr,
+                 "Usage: laic_bench [--filter TEXT] [--sizes N,N,...] [--repetitions N] [--min-sample-ms MS]\n"
+                 "                  [--check BASELINE [--threshold FACTOR]] [--write-baseline BASELINE]\n"
+                 "Sizes take K and M suffixes, from 1K up to 100M. Without --check the benchmarks run at\n"
+                 "1K, 100K and 1M; --write-baseline records the MyRange/loop slowdown at 100K unless\n"
+                 "--sizes is given, and --check fails when a slowdown exceeds its baseline by FACTOR (2)\n");
+}
+
+int main(int argc, char** argv) {
+    // Large buffers come from the heap instead of fresh mappings that fault in page by page, so
+    // a timing does not depend on the allocations that happened to run before it
+    mallopt(M_MMAP_THRESHOLD, 1 << 30);
+    mallopt(M_TRIM_THRESHOLD, 1 << 30);
+
+    Options options;
+    try {
+        for (int i = 1; i < argc; ++i) {
+            const std::string arg = argv[i];
+            auto value = [&]() -> std::string {
+                if (i + 1 >= argc) throw std::invalid_argument("Missing value for " + arg);
+                return argv[++i];
+            };
+            if (arg == "--filter") options.filter = value();
+            else if (arg == "--sizes") {
+                std::istringstream list(value());
+                std::string size;
+                while (std::getline(list, size, ',')) options.sizes.push_back(ParseSize(size));
+            }
+            else if (arg == "--repetitions") options.repetitions = std::max(1, std::stoi(value()));
+            else if (arg == "--min-sample-ms") options.minSampleMs = std::stod(value());
+            else if (arg == "--check") options.checkFile = value();
+            else if (arg == "--threshold") options.threshold = std::stod(value());
+            else if (arg == "--write-baseline") options.baselineFile = value();
+            else {
+                Usage();
+                return arg == "--help" ? 0 : 2;
+            }
+        }
+    } catch (const std::exception& e) {
+        std::fprintf(stderr, "%s\n", e.what());
+        Usage();
+        return 2;
+    }
+
+    std::vector<Benchmark> benchmarks;
+    for (auto& benchmark : Benchmarks()) {
+        if (options.filter.empty() || benchmark.name.find(options.filter) != std::string::npos) benchmarks.push_back(std::move(benchmark));
+    }
+    if (!options.checkFile.empty()) return Check(Benchmarks(), options);
+    if (!options.baselineFile.empty()) {
+        if (options.sizes.empty()) options.sizes = {100000};
+        return WriteBaseline(benchmarks, options);
+    }
+    if (options.sizes.empty()) options.sizes = {1000, 100000, 1000000};
+    return RunAll(benchmarks, options);
+}
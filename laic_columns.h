@@ -0,0 +1,259 @@
+#ifndef SSBESB_LAIC_COLUMNS_H
+#define SSBESB_LAIC_COLUMNS_H
+
+#include "laic.h"
+#include <tuple>
+
+// Row filter of a ColumnRange that reads only the columns it names
+template <typename Columns>
+class ColumnFilter {
+public:
+    virtual ~ColumnFilter() = default;
+    // Appends the rows of [first, last) that pass, scanning the columns directly
+    virtual void Scan(const Columns& columns, size_t first, size_t last, ArenaVector<size_t>& selection) const = 0;
+    // Drops the rows of selection that fail
+    virtual void Refine(const Columns& columns, ArenaVector<size_t>& selection) const = 0;
+};
+
+template <typename Columns, typename Predicate, typename Indices>
+class PredicateColumnFilter;
+
+template <typename Columns, typename Predicate, size_t... Is>
+class PredicateColumnFilter<Columns, Predicate, std::index_sequence<Is...>> : public ColumnFilter<Columns> {
+public:
+    PredicateColumnFilter(Predicate predicate) : predicate_(predicate) {}
+    // Every row is written and the count advanced only when it passes, so the loop has no branch
+    void Scan(const Columns& columns, size_t first, size_t last, ArenaVector<size_t>& selection) const override {
+        size_t count = selection.size();
+        selection.resize(count + (last - first));
+        for (size_t row = first; row < last; ++row) {
+            selection[count] = row;
+            count += predicate_(std::get<Is>(columns)[row]...) ? 1 : 0;
+        }
+        selection.resize(count);
+    }
+    void Refine(const Columns& columns, ArenaVector<size_t>& selection) const override {
+        size_t count = 0;
+        for (size_t i = 0; i < selection.size(); ++i) {
+            const size_t row = selection[i];
+            selection[count] = row;
+            count += predicate_(std::get<Is>(columns)[row]...) ? 1 : 0;
+        }
+        selection.resize(count);
+    }
+private:
+    Predicate predicate_;
+};
+
+// Source producing one value per selected row of a ColumnRange, a block of rows at a time
+template <typename T, typename Range, typename Gather>
+class ColumnSource : public RangeSource<T> {
+public:
+    ColumnSource(const Range& range, Gather gather) : range_(range), gather_(gather) {}
+    void Produce(Sink<T>& sink) const override { ProduceSlice(sink, 0, range_.RowCount()); }
+    bool IsPartitionable() const override { return true; }
+    size_t Size() const override { return range_.RowCount(); }
+    std::optional<size_t> Count() const override { return range_.Count(); }
+    std::string Describe(bool) const override { return "Columns(" + std::to_string(range_.RowCount()) + " rows)"; }
+    void ProduceSlice(Sink<T>& sink, size_t first, size_t last) const override {
+        const auto& columns = range_.Columns();
+        ArenaVector<size_t> selection;
+        ArenaVector<T> batch;
+        last = std::min(last, range_.RowCount());
+        for (size_t block = first; block < last; block += Range::BlockSize) {
+            range_.SelectRows(block, std::min(last, block + Range::BlockSize), selection);
+            if constexpr (IsBatchable<T>) {
+                for (size_t offset = 0; offset < selection.size(); offset += BatchSize) {
+                    const size_t size = std::min(BatchSize, selection.size() - offset);
+                    FillBatch(batch, size, [&](size_t i) { return gather_(columns, selection[offset + i]); });
+                    if (!sink.PushBatch(batch.data(), size)) return;
+                }
+            } else {
+                for (size_t row : selection) {
+                    if (!sink.Push(gather_(columns, row))) return;
+                }
+            }
+        }
+    }
+private:
+    Range range_;
+    Gather gather_;
+};
+
+// Structure-of-arrays range: each field lives in its own contiguous column. Filters and
+// projections name the columns they read by index, so a query touches only those arrays,
+// and rows are assembled only by the terminal projection
+template <typename... Fields>
+class ColumnRange {
+public:
+    using ColumnTuple = std::tuple<std::vector<Fields>...>;
+    using Row = std::tuple<Fields...>;
+    template <size_t I>
+    using FieldType = std::tuple_element_t<I, Row>;
+
+    // Rows are filtered in blocks of this many so the selection vector stays in cache
+    static constexpr size_t BlockSize = 4096;
+
+    ColumnRange() : columns_(std::make_shared<const ColumnTuple>()) {}
+
+    // Constructor that takes one vector per field, all of the same length
+    explicit ColumnRange(std::vector<Fields>... columns);
+
+    // Splits the given members of each row into columns
+    template <typename Record>
+    static ColumnRange FromRows(const std::vector<Record>& rows, Fields Record::*... members);
+
+    // Lazy operations
+    // Keeps the rows for which predicate, called with columns Is... of the row, holds
+    template <size_t... Is, typename Predicate>
+    ColumnRange Where(Predicate predicate) const;
+
+    ColumnRange AsParallel(size_t minParallelSize = MyRange<Row>::DefaultParallelThreshold) const;
+    ColumnRange AsSequential() const;
+
+    // Projections to a MyRange over the selected rows
+    template <size_t I>
+    MyRange<FieldType<I>> Select() const;
+
+    template <size_t... Is, typename Selector>
+    auto Select(Selector selector) const -> MyRange<std::decay_t<decltype(selector(std::declval<const FieldType<Is>&>()...))>>;
+
+    MyRange<Row> Rows() const;
+
+    // Immediate operations
+    size_t Count() const;
+
+    size_t RowCount() const { return std::get<0>(*columns_).size(); }
+    const ColumnTuple& Columns() const { return *columns_; }
+
+    // Rows of [first, last) that pass every filter, replacing the contents of selection
+    void SelectRows(size_t first, size_t last, ArenaVector<size_t>& selection) const;
+
+private:
+    // MyRange over gather(columns, row) for each selected row
+    template <typename T, typename Gather>
+    MyRange<T> Project(Gather gather) const;
+
+    std::shared_ptr<const ColumnTuple> columns_;
+    std::vector<std::shared_ptr<const ColumnFilter<ColumnTuple>>> filters_;
+    bool parallel_ = false;
+    size_t parallelThreshold_ = MyRange<Row>::DefaultParallelThreshold;
+};
+
+// Builds a ColumnRange from selected members of a vector of structs
+template <typename Record, typename... Fields>
+ColumnRange<Fields...> MakeColumnRange(const std::vector<Record>& rows, Fields Record::*... members) {
+    return ColumnRange<Fields...>::FromRows(rows, members...);
+}
+
+// Implementation of ColumnRange constructor
+template <typename... Fields>
+ColumnRange<Fields...>::ColumnRange(std::vector<Fields>... columns) {
+    const size_t sizes[] = {columns.size()...};
+    for (size_t size : sizes) {
+        if (size != sizes[0]) throw std::logic_error("ColumnRange columns differ in length");
+    }
+    columns_ = std::make_shared<const ColumnTuple>(std::move(columns)...);
+}
+
+// Implementation of ColumnRange FromRows
+template <typename... Fields>
+template <typename Record>
+ColumnRange<Fields...> ColumnRange<Fields...>::FromRows(const std::vector<Record>& rows, Fields Record::*... members) {
+    auto extract = [&rows](auto member) {
+        std::vector<std::decay_t<decltype(rows.front().*member)>> column;
+        column.reserve(rows.size());
+        for (const auto& row : rows) column.push_back(row.*member);
+        return column;
+    };
+    return ColumnRange(extract(members)...);
+}
+
+// Implementation of ColumnRange Where operation
+template <typename... Fields>
+template <size_t... Is, typename Predicate>
+ColumnRange<Fields...> ColumnRange<Fields...>::Where(Predicate predicate) const {
+    ColumnRange result = *this;
+    result.filters_.push_back(ArenaShared<PredicateColumnFilter<ColumnTuple, Predicate, std::index_sequence<Is...>>>(predicate));
+    return result;
+}
+
+// Implementation of ColumnRange AsParallel operation
+template <typename... Fields>
+ColumnRange<Fields...> ColumnRange<Fields...>::AsParallel(size_t minParallelSize) const {
+    ColumnRange result = *this;
+    result.parallel_ = true;
+    result.parallelThreshold_ = minParallelSize;
+    return result;
+}
+
+// Implementation of ColumnRange AsSequential operation
+template <typename... Fields>
+ColumnRange<Fields...> ColumnRange<Fields...>::AsSequential() const {
+    ColumnRange result = *this;
+    result.parallel_ = false;
+    return result;
+}
+
+// Implementation of the ColumnRange row selection
+template <typename... Fields>
+void ColumnRange<Fields...>::SelectRows(size_t first, size_t last, ArenaVector<size_t>& selection) const {
+    selection.clear();
+    if (filters_.empty()) {
+        selection.resize(last - first);
+        std::iota(selection.begin(), selection.end(), first);
+        return;
+    }
+    filters_.front()->Scan(*columns_, first, last, selection);
+    for (size_t i = 1; i < filters_.size() && !selection.empty(); ++i) {
+        filters_[i]->Refine(*columns_, selection);
+    }
+}
+
+template <typename... Fields>
+template <typename T, typename Gather>
+MyRange<T> ColumnRange<Fields...>::Project(Gather gather) const {
+    MyRange<T> result;
+    result.source_ = ArenaShared<ColumnSource<T, ColumnRange, Gather>>(*this, gather);
+    result.parallel_ = parallel_;
+    result.parallelThreshold_ = parallelThreshold_;
+    return result;
+}
+
+// Implementation of ColumnRange single column projection
+template <typename... Fields>
+template <size_t I>
+MyRange<typename ColumnRange<Fields...>::template FieldType<I>> ColumnRange<Fields...>::Select() const {
+    return Project<FieldType<I>>([](const ColumnTuple& columns, size_t row) { return std::get<I>(columns)[row]; });
+}
+
+// Implementation of ColumnRange Select operation
+template <typename... Fields>
+template <size_t... Is, typename Selector>
+auto ColumnRange<Fields...>::Select(Selector selector) const -> MyRange<std::decay_t<decltype(selector(std::declval<const FieldType<Is>&>()...))>> {
+    using ResultType = std::decay_t<decltype(selector(std::declval<const FieldType<Is>&>()...))>;
+    return Project<ResultType>([selector](const ColumnTuple& columns, size_t row) { return selector(std::get<Is>(columns)[row]...); });
+}
+
+// Implementation of ColumnRange Rows operation
+template <typename... Fields>
+MyRange<typename ColumnRange<Fields...>::Row> ColumnRange<Fields...>::Rows() const {
+    return Project<Row>([](const ColumnTuple& columns, size_t row) {
+        return std::apply([row](const auto&... column) { return Row(column[row]...); }, columns);
+    });
+}
+
+// Implementation of ColumnRange Count operation
+template <typename... Fields>
+size_t ColumnRange<Fields...>::Count() const {
+    if (filters_.empty()) return RowCount();
+    size_t count = 0;
+    ArenaVector<size_t> selection;
+    for (size_t block = 0; block < RowCount(); block += BlockSize) {
+        SelectRows(block, std::min(RowCount(), block + BlockSize), selection);
+        count += selection.size();
+    }
+    return count;
+}
+
+#endif // SSBESB_LAIC_COLUMNS_H
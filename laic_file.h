@@ -0,0 +1,133 @@
+#ifndef SSBESB_LAIC_FILE_H
+#define SSBESB_LAIC_FILE_H
+
+#include "laic.h"
+#include <cerrno>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// Read-only mapping of a whole file, read sequentially; unmapped when the last range over it is gone
+class MappedFile {
+public:
+    explicit MappedFile(const std::string& path) {
+        const int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd < 0) throw std::system_error(errno, std::generic_category(), "cannot open " + path);
+        struct stat info;
+        if (::fstat(fd, &info) != 0) {
+            const int error = errno;
+            ::close(fd);
+            throw std::system_error(error, std::generic_category(), "cannot stat " + path);
+        }
+        size_ = static_cast<size_t>(info.st_size);
+        if (size_ > 0) {
+            void* data = ::mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (data == MAP_FAILED) {
+                const int error = errno;
+                ::close(fd);
+                throw std::system_error(error, std::generic_category(), "cannot map " + path);
+            }
+            ::madvise(data, size_, MADV_SEQUENTIAL);
+            data_ = static_cast<const char*>(data);
+        }
+        ::close(fd);
+    }
+    ~MappedFile() {
+        if (data_) ::munmap(const_cast<char*>(data_), size_);
+    }
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    const char* Data() const { return data_; }
+    size_t Size() const { return size_; }
+
+private:
+    const char* data_ = nullptr;
+    size_t size_ = 0;
+};
+
+// Source yielding the records of a mapped file in place; slices are record index ranges
+template <typename T>
+class MappedRecordSource : public RangeSource<T> {
+public:
+    MappedRecordSource(std::shared_ptr<const MappedFile> file) : file_(std::move(file)) {}
+    void Produce(Sink<T>& sink) const override { ProduceSlice(sink, 0, Size()); }
+    bool IsPartitionable() const override { return true; }
+    size_t Size() const override { return file_->Size() / sizeof(T); }
+    std::optional<size_t> Count() const override { return Size(); }
+    std::string Describe(bool) const override { return "MappedFile(" + std::to_string(Size()) + " records)"; }
+    void ProduceSlice(Sink<T>& sink, size_t first, size_t last) const override {
+        // Mappings are page aligned, so every record is suitably aligned for T
+        const T* records = reinterpret_cast<const T*>(file_->Data());
+        last = std::min(last, Size());
+        if (first < last) PushBatches(sink, records + first, last - first);
+    }
+private:
+    std::shared_ptr<const MappedFile> file_;
+};
+
+// Source yielding the lines of a mapped file as views into the mapping, without "\n" or "\r\n".
+// Slices are byte ranges; a slice yields the lines that start inside it
+class MappedLineSource : public RangeSource<std::string_view> {
+public:
+    MappedLineSource(std::shared_ptr<const MappedFile> file) : file_(std::move(file)) {}
+    void Produce(Sink<std::string_view>& sink) const override { ProduceSlice(sink, 0, Size()); }
+    bool IsPartitionable() const override { return true; }
+    size_t Size() const override { return file_->Size(); }
+    std::shared_ptr<const void> Pin() const override { return file_; }
+    std::string Describe(bool) const override { return "Lines(" + std::to_string(Size()) + " bytes)"; }
+    void ProduceSlice(Sink<std::string_view>& sink, size_t first, size_t last) const override {
+        const char* data = file_->Data();
+        const size_t size = file_->Size();
+        last = std::min(last, size);
+        size_t position = first;
+        if (position > 0 && position < size && data[position - 1] != '\n') {
+            position = LineEnd(position) + 1;
+        }
+        while (position < last) {
+            const size_t end = LineEnd(position);
+            size_t length = end - position;
+            if (length > 0 && data[end - 1] == '\r') --length;
+            if (!sink.Push(std::string_view(data + position, length))) break;
+            position = end + 1;
+        }
+    }
+private:
+    // Offset of the "\n" ending the line that contains position, or the file size
+    size_t LineEnd(size_t position) const {
+        const void* newline = std::memchr(file_->Data() + position, '\n', file_->Size() - position);
+        return newline ? static_cast<const char*>(newline) - file_->Data() : file_->Size();
+    }
+
+    std::shared_ptr<const MappedFile> file_;
+};
+
+// Implementation of FromMappedFile
+template <typename T>
+MyRange<T> MyRange<T>::FromMappedFile(const std::string& path) {
+    static_assert(std::is_trivially_copyable<T>::value, "FromMappedFile requires trivially copyable records");
+    auto file = std::make_shared<const MappedFile>(path);
+    if (file->Size() % sizeof(T) != 0) {
+        throw std::logic_error("FromMappedFile: size of " + path + " is not a multiple of the record size");
+    }
+    MyRange<T> result;
+    result.source_ = ArenaShared<MappedRecordSource<T>>(std::move(file));
+    return result;
+}
+
+// Implementation of FromLines
+template <typename T>
+MyRange<T> MyRange<T>::FromLines(const std::string& path) {
+    static_assert(std::is_same<T, std::string_view>::value, "FromLines yields MyRange<std::string_view>");
+    MyRange<T> result;
+    result.source_ = ArenaShared<MappedLineSource>(std::make_shared<const MappedFile>(path));
+    return result;
+}
+
+#endif // SSBESB_LAIC_FILE_H
@@ -0,0 +1,311 @@
+#ifndef SSBESB_LAIC_HASH_H
+#define SSBESB_LAIC_HASH_H
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <set>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include "laic_memory.h"
+
+// Detects types with an enabled std::hash specialization
+template <typename T, typename = void>
+struct IsHashable : std::false_type {};
+
+template <typename T>
+struct IsHashable<T, std::void_t<decltype(std::hash<T>()(std::declval<const T&>()))>> : std::true_type {};
+
+// Key selector returning the element itself
+struct IdentitySelector {
+    template <typename U>
+    const U& operator()(const U& value) const { return value; }
+};
+
+// Spreads a std::hash result over all 64 bits; std::hash of integers is the identity
+inline uint64_t MixHash(uint64_t hash) {
+    hash ^= hash >> 33;
+    hash *= 0xff51afd7ed558ccdULL;
+    hash ^= hash >> 33;
+    return hash;
+}
+
+// Open-addressing hash set with linear probing. Each slot has a control byte holding
+// 7 bits of the hash, so most mismatches are rejected without comparing keys
+template <typename T, typename Hash = std::hash<T>>
+class FlatHashSet {
+public:
+    FlatHashSet() = default;
+    explicit FlatHashSet(size_t expected) { Reserve(expected); }
+
+    // Inserts value; returns false when it was already present
+    bool Insert(const T& value) {
+        if ((size_ + 1) * 4 > slots_.size() * 3) Rehash(std::max<size_t>(16, slots_.size() * 2));
+        const uint64_t hash = MixHash(hasher_(value));
+        const uint8_t tag = Tag(hash);
+        for (size_t index = hash >> shift_;; index = (index + 1) & mask_) {
+            if (control_[index] == 0) {
+                control_[index] = tag;
+                slots_[index] = value;
+                ++size_;
+                return true;
+            }
+            if (control_[index] == tag && slots_[index] == value) return false;
+        }
+    }
+
+    bool Contains(const T& value) const {
+        if (size_ == 0) return false;
+        const uint64_t hash = MixHash(hasher_(value));
+        const uint8_t tag = Tag(hash);
+        for (size_t index = hash >> shift_;; index = (index + 1) & mask_) {
+            if (control_[index] == 0) return false;
+            if (control_[index] == tag && slots_[index] == value) return true;
+        }
+    }
+
+    void Reserve(size_t count) {
+        size_t capacity = 16;
+        while (capacity * 3 < count * 4) capacity *= 2;
+        if (capacity > slots_.size()) Rehash(capacity);
+    }
+
+    size_t Size() const { return size_; }
+
+private:
+    static uint8_t Tag(uint64_t hash) { return static_cast<uint8_t>(0x80 | (hash & 0x7F)); }
+
+    void Rehash(size_t capacity) {
+        ArenaVector<T> oldSlots(capacity, slots_.get_allocator());
+        ArenaVector<uint8_t> oldControl(capacity, 0, control_.get_allocator());
+        oldSlots.swap(slots_);
+        oldControl.swap(control_);
+        mask_ = capacity - 1;
+        shift_ = 64;
+        for (size_t c = capacity; c > 1; c >>= 1) --shift_;
+        for (size_t i = 0; i < oldSlots.size(); ++i) {
+            if (oldControl[i] == 0) continue;
+            const uint64_t hash = MixHash(hasher_(oldSlots[i]));
+            size_t index = hash >> shift_;
+            while (control_[index] != 0) index = (index + 1) & mask_;
+            control_[index] = Tag(hash);
+            slots_[index] = std::move(oldSlots[i]);
+        }
+    }
+
+    ArenaVector<T> slots_;
+    ArenaVector<uint8_t> control_;
+    size_t size_ = 0;
+    size_t mask_ = 0;
+    unsigned shift_ = 64;
+    Hash hasher_;
+};
+
+// Open-addressing hash map with the same layout as FlatHashSet, values kept in a parallel array
+template <typename Key, typename Value, typename Hash = std::hash<Key>>
+class FlatHashMap {
+public:
+    // Inserts key with value unless present; returns the stored value and whether it was inserted
+    std::pair<Value*, bool> Insert(const Key& key, const Value& value) {
+        if ((size_ + 1) * 4 > keys_.size() * 3) Rehash(std::max<size_t>(16, keys_.size() * 2));
+        const uint64_t hash = MixHash(hasher_(key));
+        const uint8_t tag = Tag(hash);
+        for (size_t index = hash >> shift_;; index = (index + 1) & mask_) {
+            if (control_[index] == 0) {
+                control_[index] = tag;
+                keys_[index] = key;
+                values_[index] = value;
+                ++size_;
+                return {&values_[index], true};
+            }
+            if (control_[index] == tag && keys_[index] == key) return {&values_[index], false};
+        }
+    }
+
+    const Value* Find(const Key& key) const {
+        if (size_ == 0) return nullptr;
+        const uint64_t hash = MixHash(hasher_(key));
+        const uint8_t tag = Tag(hash);
+        for (size_t index = hash >> shift_;; index = (index + 1) & mask_) {
+            if (control_[index] == 0) return nullptr;
+            if (control_[index] == tag && keys_[index] == key) return &values_[index];
+        }
+    }
+
+    size_t Size() const { return size_; }
+
+private:
+    static uint8_t Tag(uint64_t hash) { return static_cast<uint8_t>(0x80 | (hash & 0x7F)); }
+
+    void Rehash(size_t capacity) {
+        ArenaVector<Key> oldKeys(capacity, keys_.get_allocator());
+        ArenaVector<Value> oldValues(capacity, values_.get_allocator());
+        ArenaVector<uint8_t> oldControl(capacity, 0, control_.get_allocator());
+        oldKeys.swap(keys_);
+        oldValues.swap(values_);
+        oldControl.swap(control_);
+        mask_ = capacity - 1;
+        shift_ = 64;
+        for (size_t c = capacity; c > 1; c >>= 1) --shift_;
+        for (size_t i = 0; i < oldKeys.size(); ++i) {
+            if (oldControl[i] == 0) continue;
+            const uint64_t hash = MixHash(hasher_(oldKeys[i]));
+            size_t index = hash >> shift_;
+            while (control_[index] != 0) index = (index + 1) & mask_;
+            control_[index] = Tag(hash);
+            keys_[index] = std::move(oldKeys[i]);
+            values_[index] = std::move(oldValues[i]);
+        }
+    }
+
+    ArenaVector<Key> keys_;
+    ArenaVector<Value> values_;
+    ArenaVector<uint8_t> control_;
+    size_t size_ = 0;
+    size_t mask_ = 0;
+    unsigned shift_ = 64;
+    Hash hasher_;
+};
+
+// Dense numbering of keys in order of first appearance: a flat hash map for hashable keys,
+// std::map otherwise
+template <typename Key, typename = void>
+class KeyIndex {
+public:
+    // Returns the index assigned to key and whether key was seen for the first time
+    std::pair<size_t, bool> Insert(const Key& key) {
+        auto inserted = map_.emplace(key, map_.size());
+        return {inserted.first->second, inserted.second};
+    }
+    const size_t* Find(const Key& key) const {
+        auto it = map_.find(key);
+        return it == map_.end() ? nullptr : &it->second;
+    }
+    size_t Size() const { return map_.size(); }
+private:
+    std::map<Key, size_t, std::less<Key>, ArenaAllocator<std::pair<const Key, size_t>>> map_;
+};
+
+template <typename Key>
+class KeyIndex<Key, std::enable_if_t<IsHashable<Key>::value && std::is_default_constructible<Key>::value>> {
+public:
+    std::pair<size_t, bool> Insert(const Key& key) {
+        auto inserted = map_.Insert(key, map_.Size());
+        return {*inserted.first, inserted.second};
+    }
+    const size_t* Find(const Key& key) const { return map_.Find(key); }
+    size_t Size() const { return map_.Size(); }
+private:
+    FlatHashMap<Key, size_t> map_;
+};
+
+// Bit set over a growing window of integer values, for keys that cluster in a small range.
+// The window is limited to a few bytes per inserted value, beyond which TryInsert refuses
+template <typename T>
+class DenseBitmapSet {
+public:
+    // Sets the bit for value and reports in inserted whether it was new; returns false,
+    // leaving the set unchanged, when covering value would exceed the bit budget
+    bool TryInsert(T value, bool& inserted) {
+        const uint64_t key = ToKey(value);
+        ++attempts_;
+        if (words_.empty()) {
+            base_ = key & ~uint64_t(63);
+            words_.assign(1, 0);
+        }
+        if (key < base_) {
+            const uint64_t missing = (base_ - key + 63) / 64;
+            if (missing > MaxWords() || words_.size() + missing > MaxWords()) return false;
+            uint64_t grow = std::max<uint64_t>(missing, words_.size());
+            grow = std::min<uint64_t>({grow, MaxWords() - words_.size(), base_ / 64});
+            words_.insert(words_.begin(), static_cast<size_t>(grow), 0);
+            base_ -= grow * 64;
+        } else if ((key - base_) / 64 >= words_.size()) {
+            const uint64_t needed = (key - base_) / 64 + 1;
+            if (needed > MaxWords()) return false;
+            words_.resize(static_cast<size_t>(std::min<uint64_t>(MaxWords(), std::max<uint64_t>(needed, words_.size() * 2))), 0);
+        }
+        const uint64_t offset = key - base_;
+        uint64_t& word = words_[offset / 64];
+        const uint64_t bit = uint64_t(1) << (offset % 64);
+        inserted = (word & bit) == 0;
+        word |= bit;
+        if (inserted) ++size_;
+        return true;
+    }
+
+    // Visits every member in ascending order
+    template <typename Func>
+    void ForEachValue(Func func) const {
+        for (size_t i = 0; i < words_.size(); ++i) {
+            for (uint64_t word = words_[i]; word != 0; word &= word - 1) {
+                func(FromKey(base_ + i * 64 + __builtin_ctzll(word)));
+            }
+        }
+    }
+
+    size_t Size() const { return size_; }
+
+private:
+    // Order-preserving mapping of the value onto unsigned 64-bit keys
+    static uint64_t ToKey(T value) {
+        if (std::is_signed<T>::value) return static_cast<uint64_t>(static_cast<int64_t>(value)) ^ (uint64_t(1) << 63);
+        return static_cast<uint64_t>(value);
+    }
+
+    static T FromKey(uint64_t key) {
+        if (std::is_signed<T>::value) return static_cast<T>(static_cast<int64_t>(key ^ (uint64_t(1) << 63)));
+        return static_cast<T>(key);
+    }
+
+    // Budget of four bytes per value inserted so far, and at least 2 MiB
+    size_t MaxWords() const { return std::max<size_t>(size_t(1) << 18, attempts_ / 2); }
+
+    uint64_t base_ = 0;
+    ArenaVector<uint64_t> words_;
+    size_t size_ = 0;
+    size_t attempts_ = 0;
+};
+
+// Set tracking keys already seen by Distinct: a dense bitmap for clustered integers that
+// falls back to a flat hash set, a flat hash set for other hashable keys, std::set otherwise
+template <typename Key, typename = void>
+class DistinctSet {
+public:
+    bool Insert(const Key& key) { return set_.insert(key).second; }
+private:
+    std::set<Key, std::less<Key>, ArenaAllocator<Key>> set_;
+};
+
+template <typename Key>
+class DistinctSet<Key, std::enable_if_t<IsHashable<Key>::value && !std::is_integral<Key>::value && std::is_default_constructible<Key>::value>> {
+public:
+    bool Insert(const Key& key) { return set_.Insert(key); }
+private:
+    FlatHashSet<Key> set_;
+};
+
+template <typename Key>
+class DistinctSet<Key, std::enable_if_t<std::is_integral<Key>::value>> {
+public:
+    bool Insert(const Key& key) {
+        if (dense_) {
+            bool inserted = false;
+            if (bitmap_.TryInsert(key, inserted)) return inserted;
+            dense_ = false;
+            hash_.Reserve(bitmap_.Size() * 2);
+            bitmap_.ForEachValue([&](Key value) { hash_.Insert(value); });
+            bitmap_ = DenseBitmapSet<Key>();
+        }
+        return hash_.Insert(key);
+    }
+private:
+    bool dense_ = true;
+    DenseBitmapSet<Key> bitmap_;
+    FlatHashSet<Key> hash_;
+};
+
+#endif // SSBESB_LAIC_HASH_H
@@ -3,217 +3,1042 @@
 
 #include "laic.h"
 
+// Implementation of the fused evaluation loop
+template <typename T>
+void MyRange<T>::Run(Sink<T>& sink, size_t first, size_t last) const {
+#ifdef LAIC_PROFILE
+    // Every stage allocates through a resource charging the operator whose stage is running,
+    // and is wrapped in probes counting what enters it and what leaves the last one
+    ArenaScope profiling(ProfilingResourceFor(CurrentResource()));
+    ArenaVector<ArenaPtr<Sink<T>>> probes;
+#endif
+    ArenaVector<ArenaPtr<Sink<T>>> stages;
+    Sink<T>* head = &sink;
+    for (auto it = operations_.rbegin(); it != operations_.rend(); ++it) {
+#ifdef LAIC_PROFILE
+        OperatorProfile& profile = (*it)->Profile();
+        ++profile.runs;
+        if (it == operations_.rbegin()) {
+            probes.push_back(ArenaNew<ProbeSink<T>>(*head, profile, false));
+            head = probes.back().get();
+        }
+        ProfileScope scope(profile, false);
+#endif
+        stages.push_back((*it)->Wrap(*head));
+        head = stages.back().get();
+#ifdef LAIC_PROFILE
+        probes.push_back(ArenaNew<ProbeSink<T>>(*head, profile, true));
+        head = probes.back().get();
+#endif
+    }
+    // A leading ReverseTake keeps only the last elements of the source, so reading starts there
+    if (!operations_.empty() && operations_.front()->Kind() == OperationKind::ReverseTake &&
+        (!source_ || source_->IsPartitionable())) {
+        const size_t count = static_cast<const ReverseTakeOperation<T>&>(*operations_.front()).Count();
+        last = std::min(last, SourceSize());
+        first = std::max(first, last > count ? last - count : 0);
+    }
+    if (source_) {
+        if (first == 0 && last == SIZE_MAX) {
+            source_->Produce(*head);
+        } else {
+            source_->ProduceSlice(*head, first, last);
+        }
+    } else {
+        PushSlice(*head, Data(), first, last);
+    }
+    head->Finish();
+}
+
+// Implementation of the chunk count behind parallel execution
+template <typename T>
+size_t MyRange<T>::ChunkCount() const {
+#ifdef _OPENMP
+    const size_t size = SourceSize();
+    if (parallel_ && size >= parallelThreshold_ && IsPartitionable()) {
+        return std::max<size_t>(1, std::min(static_cast<size_t>(omp_get_max_threads()), size));
+    }
+#endif
+    return 1;
+}
+
+// Implementation of the chunked fold behind parallel execution
+template <typename T>
+template <typename Result, typename Func>
+std::vector<Result> MyRange<T>::FoldChunks(const Result& initial, Func func) const {
+    const size_t chunkCount = ChunkCount();
+    std::vector<Result> results(chunkCount, initial);
+    if (chunkCount == 1) {
+        Result result = initial;
+        ForEach([&](const T& value) { return func(result, value); });
+        results[0] = std::move(result);
+        return results;
+    }
+    const size_t size = SourceSize();
+#pragma omp parallel for schedule(static)
+    for (long long chunk = 0; chunk < static_cast<long long>(chunkCount); ++chunk) {
+        const size_t first = size * chunk / chunkCount;
+        const size_t last = size * (chunk + 1) / chunkCount;
+        Result result = initial;
+        ForEach([&](const T& value) { return func(result, value); }, first, last);
+        results[chunk] = std::move(result);
+    }
+    return results;
+}
+
+// Implementation of the chunked batch fold behind the SIMD aggregates
+template <typename T>
+template <typename Result, typename Func, typename BatchFunc>
+std::vector<Result> MyRange<T>::FoldChunks(const Result& initial, Func func, BatchFunc batchFunc) const {
+    const size_t chunkCount = ChunkCount();
+    const size_t size = SourceSize();
+    std::vector<Result> results(chunkCount, initial);
+#pragma omp parallel for schedule(static) if (chunkCount > 1)
+    for (long long chunk = 0; chunk < static_cast<long long>(chunkCount); ++chunk) {
+        const size_t first = chunkCount == 1 ? 0 : size * chunk / chunkCount;
+        const size_t last = chunkCount == 1 ? SIZE_MAX : size * (chunk + 1) / chunkCount;
+        Result result = initial;
+        if (IsBuffered()) {
+            const auto& data = Data();
+            const size_t end = std::min(last, data.size());
+            if (first < end) batchFunc(result, data.data() + first, end - first);
+        } else {
+            BatchFoldSink<T, Result, Func, BatchFunc> sink(result, func, batchFunc);
+            Run(sink, first, last);
+        }
+        results[chunk] = std::move(result);
+    }
+    return results;
+}
+
+// Implementation of the chunked visit behind parallel All and Any
+template <typename T>
+template <typename Func>
+void MyRange<T>::ForEachChunk(Func func) const {
+    const size_t chunkCount = ChunkCount();
+    if (chunkCount == 1) {
+        ForEach(func);
+        return;
+    }
+    const size_t size = SourceSize();
+#pragma omp parallel for schedule(static)
+    for (long long chunk = 0; chunk < static_cast<long long>(chunkCount); ++chunk) {
+        ForEach(func, size * chunk / chunkCount, size * (chunk + 1) / chunkCount);
+    }
+}
+
+// Implementation of the chunked kernel application over a buffered range
+template <typename T>
+template <typename Kernel>
+auto MyRange<T>::FoldBuffer(Kernel kernel) const -> std::vector<decltype(kernel(std::declval<const T*>(), size_t(0)))> {
+    const auto& data = Data();
+    const size_t chunkCount = ChunkCount();
+    std::vector<decltype(kernel(std::declval<const T*>(), size_t(0)))> results(chunkCount);
+#pragma omp parallel for schedule(static) if (chunkCount > 1)
+    for (long long chunk = 0; chunk < static_cast<long long>(chunkCount); ++chunk) {
+        const size_t first = data.size() * chunk / chunkCount;
+        const size_t last = data.size() * (chunk + 1) / chunkCount;
+        results[chunk] = kernel(data.data() + first, last - first);
+    }
+    return results;
+}
+
+// Implementation of AsParallel operation
+template <typename T>
+MyRange<T> MyRange<T>::AsParallel(size_t minParallelSize) const {
+    MyRange<T> result = *this;
+    result.parallel_ = true;
+    result.parallelThreshold_ = minParallelSize;
+    return result;
+}
+
+// Implementation of AsSequential operation
+template <typename T>
+MyRange<T> MyRange<T>::AsSequential() const {
+    MyRange<T> result = *this;
+    result.parallel_ = false;
+    return result;
+}
+
 // Implementation of Where operation
 template <typename T>
 template <typename Predicate>
 MyRange<T> MyRange<T>::Where(Predicate predicate) const {
-    MyRange<T> result = *this;
-    result.operations_.push_back(std::make_shared<WhereOperation<T, Predicate>>(predicate));
-    return result;
+    return WithOperation(ArenaShared<WhereOperation<T, Predicate>>(predicate));
 }
 
 // Implementation of Select operation
 template <typename T>
 template <typename Selector>
 auto MyRange<T>::Select(Selector selector) const -> MyRange<decltype(selector(std::declval<T>()))> {
-    MyRange<decltype(selector(std::declval<T>()))> result(ToVector());
-    result.operations_.push_back(std::make_shared<SelectOperation<T, Selector>>(selector));
-    return result;
+    using ResultType = decltype(selector(std::declval<T>()));
+    if constexpr (std::is_same<ResultType, T>::value) {
+        return WithOperation(ArenaShared<SelectOperation<T, Selector>>(selector));
+    } else {
+        MyRange<ResultType> result;
+        result.source_ = ArenaShared<SelectSource<ResultType, T, Selector>>(*this, selector);
+        result.parallel_ = parallel_;
+        result.parallelThreshold_ = parallelThreshold_;
+        return result;
+    }
 }
 
 // Implementation of Take operation
 template <typename T>
 MyRange<T> MyRange<T>::Take(size_t count) const {
-    MyRange<T> result = *this;
-    result.operations_.push_back(std::make_shared<CustomOperation<T, std::function<void(std::vector<T>&)>>>([count](std::vector<T>& data) {
-        if (count < data.size()) {
-            data.resize(count);
-        }
-    }));
-    return result;
+    return WithOperation(ArenaShared<TakeOperation<T>>(count));
 }
 
 // Implementation of Skip operation
 template <typename T>
 MyRange<T> MyRange<T>::Skip(size_t count) const {
-    MyRange<T> result = *this;
-    result.operations_.push_back(std::make_shared<CustomOperation<T, std::function<void(std::vector<T>&)>>>([count](std::vector<T>& data) {
-        if (count < data.size()) {
-            data.erase(data.begin(), data.begin() + count);
-        } else {
-            data.clear();
-        }
-    }));
-    return result;
+    return WithOperation(ArenaShared<SkipOperation<T>>(count));
 }
 
 // Implementation of Concat operation
 template <typename T>
 MyRange<T> MyRange<T>::Concat(const MyRange& other) const {
-    MyRange<T> result = *this;
-    result.operations_.push_back(std::make_shared<CustomOperation<T, std::function<void(std::vector<T>&)>>>([other](std::vector<T>& data) {
-        auto otherData = other.ToVector();
-        data.insert(data.end(), otherData.begin(), otherData.end());
-    }));
-    return result;
+    return WithOperation(ArenaShared<ConcatOperation<T>>(other));
 }
 
 // Implementation of Reverse operation
 template <typename T>
 MyRange<T> MyRange<T>::Reverse() const {
-    MyRange<T> result = *this;
-    result.operations_.push_back(std::make_shared<CustomOperation<T, std::function<void(std::vector<T>&)>>>([](std::vector<T>& data) {
-        std::reverse(data.begin(), data.end());
-    }));
-    return result;
+    return WithOperation(ArenaShared<ReverseOperation<T>>());
 }
 
 // Implementation of Distinct operation
 template <typename T>
 MyRange<T> MyRange<T>::Distinct() const {
-    MyRange<T> result = *this;
-    result.operations_.push_back(std::make_shared<CustomOperation<T, std::function<void(std::vector<T>&)>>>([](std::vector<T>& data) {
-        std::set<T> unique_elements(data.begin(), data.end());
-        data.assign(unique_elements.begin(), unique_elements.end());
-    }));
+    return DistinctBy(IdentitySelector());
+}
+
+// Implementation of Memoize operation
+template <typename T>
+MyRange<T> MyRange<T>::Memoize() const {
+    if (IsBuffered()) return *this;
+    MyRange<T> result;
+    result.source_ = ArenaShared<MemoSource<T>>(*this);
+    result.parallel_ = parallel_;
+    result.parallelThreshold_ = parallelThreshold_;
     return result;
 }
 
+// Implementation of DistinctBy operation
+template <typename T>
+template <typename KeySelector>
+MyRange<T> MyRange<T>::DistinctBy(KeySelector keySelector) const {
+    return WithOperation(ArenaShared<DistinctOperation<T, KeySelector>>(keySelector));
+}
+
 // Implementation of OrderBy operation
 template <typename T>
 template <typename KeySelector>
 auto MyRange<T>::OrderBy(KeySelector keySelector) const -> MyRange<T> {
+    return AddSortKey(keySelector, false, false);
+}
+
+// Implementation of OrderByDescending operation
+template <typename T>
+template <typename KeySelector>
+MyRange<T> MyRange<T>::OrderByDescending(KeySelector keySelector) const {
+    return AddSortKey(keySelector, true, false);
+}
+
+// Implementation of ThenBy operation
+template <typename T>
+template <typename KeySelector>
+MyRange<T> MyRange<T>::ThenBy(KeySelector keySelector) const {
+    return AddSortKey(keySelector, false, true);
+}
+
+// Implementation of ThenByDescending operation
+template <typename T>
+template <typename KeySelector>
+MyRange<T> MyRange<T>::ThenByDescending(KeySelector keySelector) const {
+    return AddSortKey(keySelector, true, true);
+}
+
+// Implementation of the shared ordering builder
+template <typename T>
+template <typename KeySelector>
+MyRange<T> MyRange<T>::AddSortKey(KeySelector keySelector, bool descending, bool thenBy) const {
+    auto key = ArenaShared<SelectorSortKey<T, KeySelector>>(keySelector, descending);
+    if (!thenBy) {
+        return WithOperation(ArenaShared<OrderOperation<T>>(std::vector<std::shared_ptr<const SortKey<T>>>{key}), descending ? "OrderByDescending" : "OrderBy");
+    }
+    auto ordering = TrailingOrdering();
+    if (!ordering || ordering->Limit() != SIZE_MAX) throw std::logic_error("ThenBy requires a preceding OrderBy");
     MyRange<T> result = *this;
-    result.operations_.push_back(std::make_shared<CustomOperation<T, std::function<void(std::vector<T>&)>>>([keySelector](std::vector<T>& data) {
-        std::sort(data.begin(), data.end(), [&](const T& a, const T& b) {
-            return keySelector(a) < keySelector(b);
-        });
-    }));
+    auto keys = ordering->Keys();
+    keys.push_back(key);
+    result.operations_.back() = ArenaShared<OrderOperation<T>>(std::move(keys));
+    result.written_ = std::make_shared<const PlanStep>(PlanStep{descending ? "ThenByDescending" : "ThenBy", written_});
+    return result;
+}
+
+// Implementation of the operation builder behind the lazy operations
+template <typename T>
+MyRange<T> MyRange<T>::WithOperation(std::shared_ptr<LazyOperation<T>> operation, std::string written) const {
+    MyRange<T> result = *this;
+    if (written.empty()) written = operation->Describe();
+    result.written_ = std::make_shared<const PlanStep>(PlanStep{std::move(written), written_});
+    AddOperation(result.operations_, std::move(operation));
+    return result;
+}
+
+// Implementation of the rewrites applied as operations are added
+template <typename T>
+void MyRange<T>::AddOperation(std::vector<std::shared_ptr<LazyOperation<T>>>& operations, std::shared_ptr<LazyOperation<T>> operation) {
+    using Operations = std::vector<std::shared_ptr<LazyOperation<T>>>;
+    const OperationKind kind = operation->Kind();
+    if (kind == OperationKind::Where) {
+        // Filtering commutes with full sorts, and with Distinct when equal elements are identical,
+        // so it moves ahead of them, and fuses with a filter it meets there
+        size_t position = operations.size();
+        while (position > 0) {
+            const auto& previous = *operations[position - 1];
+            const bool fullSort = previous.Kind() == OperationKind::Order && static_cast<const OrderOperation<T>&>(previous).Limit() == SIZE_MAX;
+            const bool distinct = EqualityIsIdentity<T> && previous.Kind() == OperationKind::Distinct;
+            if (!fullSort && !distinct) break;
+            --position;
+        }
+        if (position > 0 && operations[position - 1]->Kind() == OperationKind::Where) {
+            std::vector<std::shared_ptr<const FilterOperation<T>>> filters;
+            for (const auto& fused : {operations[position - 1], operation}) {
+                if (auto conjunction = std::dynamic_pointer_cast<const ConjunctionOperation<T>>(fused)) {
+                    filters.insert(filters.end(), conjunction->Filters().begin(), conjunction->Filters().end());
+                } else {
+                    filters.push_back(std::static_pointer_cast<const FilterOperation<T>>(fused));
+                }
+            }
+            operations[position - 1] = ArenaShared<ConjunctionOperation<T>>(std::move(filters));
+        } else {
+            operations.insert(operations.begin() + static_cast<typename Operations::difference_type>(position), std::move(operation));
+        }
+        return;
+    }
+    if (!operations.empty()) {
+        auto& last = operations.back();
+        const OperationKind lastKind = last->Kind();
+        if (kind == OperationKind::Take) {
+            const size_t count = static_cast<const TakeOperation<T>&>(*operation).Count();
+            // OrderBy followed by Take becomes a top-k selection
+            if (lastKind == OperationKind::Order) {
+                const auto& ordering = static_cast<const OrderOperation<T>&>(*last);
+                last = ArenaShared<OrderOperation<T>>(ordering.Keys(), std::min(count, ordering.Limit()));
+                return;
+            }
+            if (lastKind == OperationKind::Take) {
+                last = ArenaShared<TakeOperation<T>>(std::min(count, static_cast<const TakeOperation<T>&>(*last).Count()));
+                return;
+            }
+            if (lastKind == OperationKind::Reverse) {
+                last = ArenaShared<ReverseTakeOperation<T>>(count);
+                return;
+            }
+            if (lastKind == OperationKind::ReverseTake) {
+                last = ArenaShared<ReverseTakeOperation<T>>(std::min(count, static_cast<const ReverseTakeOperation<T>&>(*last).Count()));
+                return;
+            }
+        } else if (kind == OperationKind::Skip && lastKind == OperationKind::Skip) {
+            const size_t skipped = static_cast<const SkipOperation<T>&>(*last).Count();
+            const size_t count = static_cast<const SkipOperation<T>&>(*operation).Count();
+            last = ArenaShared<SkipOperation<T>>(count > SIZE_MAX - skipped ? SIZE_MAX : skipped + count);
+            return;
+        } else if (kind == OperationKind::Reverse && lastKind == OperationKind::Reverse) {
+            operations.pop_back();
+            return;
+        }
+    }
+    operations.push_back(std::move(operation));
+}
+
+// Implementation of the plan used by Count
+template <typename T>
+std::vector<std::shared_ptr<LazyOperation<T>>> MyRange<T>::CountPlan(std::vector<std::shared_ptr<LazyOperation<T>>> operations) {
+    // Walking back from the count, track whether the values or the order of the elements
+    // reaching each operation can still affect the result
+    bool valuesUsed = false;
+    bool orderUsed = false;
+    for (size_t i = operations.size(); i-- > 0;) {
+        auto& operation = operations[i];
+        switch (operation->Kind()) {
+        case OperationKind::Select:
+            if (!valuesUsed) operations.erase(operations.begin() + static_cast<std::ptrdiff_t>(i));
+            break;
+        case OperationKind::Reverse:
+        case OperationKind::Order:
+        case OperationKind::ReverseTake: {
+            size_t limit = SIZE_MAX;
+            if (operation->Kind() == OperationKind::Order) limit = static_cast<const OrderOperation<T>&>(*operation).Limit();
+            if (operation->Kind() == OperationKind::ReverseTake) limit = static_cast<const ReverseTakeOperation<T>&>(*operation).Count();
+            if (limit == SIZE_MAX) {
+                if (!orderUsed) operations.erase(operations.begin() + static_cast<std::ptrdiff_t>(i));
+            } else if (!valuesUsed) {
+                operation = ArenaShared<TakeOperation<T>>(limit);
+            } else {
+                orderUsed = true;
+            }
+            break;
+        }
+        case OperationKind::Take:
+        case OperationKind::Skip:
+            if (valuesUsed) orderUsed = true;
+            break;
+        case OperationKind::Concat:
+            break;
+        case OperationKind::Where:
+            valuesUsed = true;
+            break;
+        case OperationKind::Distinct:
+        case OperationKind::DistinctBy:
+            if (valuesUsed) orderUsed = true;
+            valuesUsed = true;
+            break;
+        default:
+            valuesUsed = true;
+            orderUsed = true;
+            break;
+        }
+    }
+    return operations;
+}
+
+// Implementation of the plan description
+template <typename T>
+std::string MyRange<T>::Plan(bool asWritten) const {
+    std::string plan = source_ ? source_->Describe(asWritten) : "Buffer(" + std::to_string(Data().size()) + " elements)";
+    if (asWritten) {
+        std::vector<const std::string*> steps;
+        for (const PlanStep* step = written_.get(); step; step = step->previous.get()) {
+            steps.push_back(&step->description);
+        }
+        for (auto it = steps.rbegin(); it != steps.rend(); ++it) plan += " -> " + **it;
+    } else {
+        for (const auto& operation : operations_) plan += " -> " + operation->Describe();
+    }
+    return plan;
+}
+
+// Implementation of the ExplainAnalyze run
+template <typename T>
+QueryReport MyRange<T>::Analyze() const {
+    QueryReport report;
+    report.plan = Plan(false);
+#ifdef LAIC_PROFILE
+    for (const auto& operation : operations_) operation->Profile().Reset();
+#endif
+    const auto start = std::chrono::steady_clock::now();
+    auto counts = FoldChunks(size_t(0), [](size_t& count, const T&) { ++count; return true; });
+    report.nanoseconds = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count());
+    report.elements = std::accumulate(counts.begin(), counts.end(), size_t(0));
+#ifdef LAIC_PROFILE
+    uint64_t downstream = 0;
+    for (size_t i = operations_.size(); i-- > 0;) {
+        const OperatorProfile& profile = operations_[i]->Profile();
+        OperatorReport op;
+        op.name = operations_[i]->Describe();
+        op.runs = profile.runs;
+        op.elementsIn = profile.elementsIn;
+        op.elementsOut = i + 1 < operations_.size() ? operations_[i + 1]->Profile().elementsIn.load() : profile.elementsOut.load();
+        op.selfNanoseconds = profile.nanoseconds > downstream ? profile.nanoseconds - downstream : 0;
+        op.bytesAllocated = profile.bytesAllocated;
+        downstream = profile.nanoseconds;
+        report.operators.insert(report.operators.begin(), op);
+    }
+    report.sourceNanoseconds = report.nanoseconds > downstream ? report.nanoseconds - downstream : 0;
+#endif
+    return report;
+}
+
+// Implementation of ExplainAnalyze operation
+template <typename T>
+std::string MyRange<T>::ExplainAnalyze() const {
+    return Analyze().ToText();
+}
+
+// Implementation of ExplainAnalyzeJson operation
+template <typename T>
+std::string MyRange<T>::ExplainAnalyzeJson() const {
+    return Analyze().ToJson();
+}
+
+// Implementation of Explain operation
+template <typename T>
+std::string MyRange<T>::Explain() const {
+    return "Written:   " + Plan(true) + "\nOptimized: " + Plan(false) + "\n";
+}
+
+// Implementation of Join operation
+template <typename T>
+template <typename Inner, typename OuterKey, typename InnerKey, typename ResultSelector>
+auto MyRange<T>::Join(const MyRange<Inner>& inner, OuterKey outerKey, InnerKey innerKey, ResultSelector resultSelector) const
+    -> MyRange<std::decay_t<decltype(resultSelector(std::declval<const T&>(), std::declval<const Inner&>()))>> {
+    using ResultType = std::decay_t<decltype(resultSelector(std::declval<const T&>(), std::declval<const Inner&>()))>;
+    MyRange<ResultType> result;
+    result.source_ = ArenaShared<JoinSource<ResultType, T, Inner, OuterKey, InnerKey, ResultSelector, false>>(*this, inner, outerKey, innerKey, resultSelector);
+    result.parallel_ = parallel_;
+    result.parallelThreshold_ = parallelThreshold_;
+    return result;
+}
+
+// Implementation of GroupJoin operation
+template <typename T>
+template <typename Inner, typename OuterKey, typename InnerKey, typename ResultSelector>
+auto MyRange<T>::GroupJoin(const MyRange<Inner>& inner, OuterKey outerKey, InnerKey innerKey, ResultSelector resultSelector) const
+    -> MyRange<std::decay_t<decltype(resultSelector(std::declval<const T&>(), std::declval<const std::vector<Inner>&>()))>> {
+    using ResultType = std::decay_t<decltype(resultSelector(std::declval<const T&>(), std::declval<const std::vector<Inner>&>()))>;
+    MyRange<ResultType> result;
+    result.source_ = ArenaShared<JoinSource<ResultType, T, Inner, OuterKey, InnerKey, ResultSelector, true>>(*this, inner, outerKey, innerKey, resultSelector);
+    result.parallel_ = parallel_;
+    result.parallelThreshold_ = parallelThreshold_;
     return result;
 }
 
+// Implementation of Intersect operation
+template <typename T>
+MyRange<T> MyRange<T>::Intersect(const MyRange& other) const {
+    MyRange<T> result;
+    result.source_ = ArenaShared<SetFilterSource<T>>(*this, other, true);
+    result.parallel_ = parallel_;
+    result.parallelThreshold_ = parallelThreshold_;
+    return result;
+}
+
+// Implementation of Except operation
+template <typename T>
+MyRange<T> MyRange<T>::Except(const MyRange& other) const {
+    MyRange<T> result;
+    result.source_ = ArenaShared<SetFilterSource<T>>(*this, other, false);
+    result.parallel_ = parallel_;
+    result.parallelThreshold_ = parallelThreshold_;
+    return result;
+}
+
+// Implementation of Union operation
+template <typename T>
+MyRange<T> MyRange<T>::Union(const MyRange& other) const {
+    return Concat(other).Distinct();
+}
+
 // Implementation of GroupBy operation
 template <typename T>
 template <typename KeySelector>
-auto MyRange<T>::GroupBy(KeySelector keySelector) const -> MyRange<std::pair<decltype(keySelector(std::declval<T>())), std::vector<T>>> {
-    using KeyType = decltype(keySelector(std::declval<T>()));
-    std::map<KeyType, std::vector<T>> groups;
-    for (const auto& item : data_) {
-        groups[keySelector(item)].push_back(item);
+GroupedRange<T, KeySelector> MyRange<T>::GroupBy(KeySelector keySelector) const {
+    return GroupedRange<T, KeySelector>(*this, keySelector);
+}
+
+// Implementation of the per-key fold behind GroupBy
+template <typename T, typename KeySelector>
+template <typename Acc, typename Fold, typename Combine>
+ArenaVector<std::pair<typename GroupedRange<T, KeySelector>::KeyType, Acc>> GroupedRange<T, KeySelector>::FoldGroups(const Acc& initial, Fold fold, Combine combine) const {
+    struct Table {
+        KeyIndex<KeyType> index;
+        ArenaVector<std::pair<KeyType, Acc>> groups;
+    };
+    auto tables = source_.FoldChunks(Table(), [&](Table& table, const T& value) {
+        KeyType key = keySelector_(value);
+        auto slot = table.index.Insert(key);
+        if (slot.second) table.groups.emplace_back(std::move(key), initial);
+        fold(table.groups[slot.first].second, value);
+        return true;
+    });
+    Table& result = tables.front();
+    for (size_t i = 1; i < tables.size(); ++i) {
+        for (auto& group : tables[i].groups) {
+            auto slot = result.index.Insert(group.first);
+            if (slot.second) {
+                result.groups.push_back(std::move(group));
+            } else {
+                combine(result.groups[slot.first].second, group.second);
+            }
+        }
     }
-    std::vector<std::pair<KeyType, std::vector<T>>> result(groups.begin(), groups.end());
-    return MyRange<std::pair<KeyType, std::vector<T>>>(result);
+    return std::move(result.groups);
+}
+
+template <typename T, typename KeySelector>
+template <typename U, typename Generator>
+MyRange<U> GroupedRange<T, KeySelector>::Defer(Generator generator) const {
+    MyRange<U> result;
+    auto pin = [source = source_] { return source.Pin(); };
+    result.source_ = ArenaShared<GeneratorSource<U, Generator, decltype(pin)>>(generator, pin);
+    result.parallel_ = source_.parallel_;
+    result.parallelThreshold_ = source_.parallelThreshold_;
+    return result;
+}
+
+// Implementation of GroupBy materialization
+template <typename T, typename KeySelector>
+MyRange<std::pair<typename GroupedRange<T, KeySelector>::KeyType, std::vector<T>>> GroupedRange<T, KeySelector>::ToRange() const {
+    auto self = *this;
+    return Defer<std::pair<KeyType, std::vector<T>>>([self]() {
+        return self.FoldGroups(std::vector<T>(),
+            [](std::vector<T>& group, const T& value) { group.push_back(value); },
+            [](std::vector<T>& group, std::vector<T>& more) { group.insert(group.end(), more.begin(), more.end()); });
+    });
+}
+
+// Implementation of GroupBy Count aggregate
+template <typename T, typename KeySelector>
+MyRange<std::pair<typename GroupedRange<T, KeySelector>::KeyType, size_t>> GroupedRange<T, KeySelector>::Count() const {
+    auto self = *this;
+    return Defer<std::pair<KeyType, size_t>>([self]() {
+        return self.FoldGroups(size_t(0),
+            [](size_t& count, const T&) { ++count; },
+            [](size_t& count, size_t& more) { count += more; });
+    });
+}
+
+// Implementation of GroupBy Sum aggregate
+template <typename T, typename KeySelector>
+template <typename Selector>
+auto GroupedRange<T, KeySelector>::Sum(Selector selector) const -> MyRange<std::pair<KeyType, std::decay_t<decltype(selector(std::declval<const T&>()))>>> {
+    using Result = std::decay_t<decltype(selector(std::declval<const T&>()))>;
+    auto self = *this;
+    return Defer<std::pair<KeyType, Result>>([self, selector]() {
+        return self.FoldGroups(Result(0),
+            [&](Result& sum, const T& value) { sum = sum + selector(value); },
+            [](Result& sum, Result& more) { sum = sum + more; });
+    });
+}
+
+// Implementation of GroupBy Average aggregate
+template <typename T, typename KeySelector>
+template <typename Selector>
+MyRange<std::pair<typename GroupedRange<T, KeySelector>::KeyType, double>> GroupedRange<T, KeySelector>::Average(Selector selector) const {
+    using Result = std::decay_t<decltype(selector(std::declval<const T&>()))>;
+    using Partial = std::pair<Result, size_t>;
+    auto self = *this;
+    return Defer<std::pair<KeyType, double>>([self, selector]() {
+        auto partials = self.FoldGroups(Partial(Result(0), 0),
+            [&](Partial& partial, const T& value) { partial.first = partial.first + selector(value); ++partial.second; },
+            [](Partial& partial, Partial& more) { partial.first = partial.first + more.first; partial.second += more.second; });
+        ArenaVector<std::pair<KeyType, double>> averages;
+        averages.reserve(partials.size());
+        for (auto& partial : partials) {
+            averages.emplace_back(std::move(partial.first), static_cast<double>(partial.second.first) / partial.second.second);
+        }
+        return averages;
+    });
+}
+
+// Implementation of GroupBy Min aggregate
+template <typename T, typename KeySelector>
+template <typename Selector>
+auto GroupedRange<T, KeySelector>::Min(Selector selector) const -> MyRange<std::pair<KeyType, std::decay_t<decltype(selector(std::declval<const T&>()))>>> {
+    using Result = std::decay_t<decltype(selector(std::declval<const T&>()))>;
+    auto self = *this;
+    return Defer<std::pair<KeyType, Result>>([self, selector]() {
+        auto mins = self.FoldGroups(std::optional<Result>(),
+            [&](std::optional<Result>& min, const T& value) {
+                Result candidate = selector(value);
+                if (!min || candidate < *min) min = std::move(candidate);
+            },
+            [](std::optional<Result>& min, std::optional<Result>& more) {
+                if (*more < *min) min = std::move(more);
+            });
+        ArenaVector<std::pair<KeyType, Result>> result;
+        result.reserve(mins.size());
+        for (auto& min : mins) result.emplace_back(std::move(min.first), std::move(*min.second));
+        return result;
+    });
 }
 
+// Implementation of GroupBy Max aggregate
+template <typename T, typename KeySelector>
+template <typename Selector>
+auto GroupedRange<T, KeySelector>::Max(Selector selector) const -> MyRange<std::pair<KeyType, std::decay_t<decltype(selector(std::declval<const T&>()))>>> {
+    using Result = std::decay_t<decltype(selector(std::declval<const T&>()))>;
+    auto self = *this;
+    return Defer<std::pair<KeyType, Result>>([self, selector]() {
+        auto maxes = self.FoldGroups(std::optional<Result>(),
+            [&](std::optional<Result>& max, const T& value) {
+                Result candidate = selector(value);
+                if (!max || *max < candidate) max = std::move(candidate);
+            },
+            [](std::optional<Result>& max, std::optional<Result>& more) {
+                if (*max < *more) max = std::move(more);
+            });
+        ArenaVector<std::pair<KeyType, Result>> result;
+        result.reserve(maxes.size());
+        for (auto& max : maxes) result.emplace_back(std::move(max.first), std::move(*max.second));
+        return result;
+    });
+}
+
+// Implementation of GroupBy Aggregate operation
+template <typename T, typename KeySelector>
+template <typename Seed, typename Func>
+MyRange<std::pair<typename GroupedRange<T, KeySelector>::KeyType, Seed>> GroupedRange<T, KeySelector>::Aggregate(Seed seed, Func func) const {
+    GroupedRange sequential(source_.AsSequential(), keySelector_);
+    return Defer<std::pair<KeyType, Seed>>([sequential, seed, func]() {
+        return sequential.FoldGroups(seed,
+            [&](Seed& acc, const T& value) { acc = func(std::move(acc), value); },
+            [](Seed&, Seed&) {});
+    });
+}
 
 // Implementation of All operation
 template <typename T>
-bool MyRange<T>::All(std::function<bool(T)> predicate) const {
-    Evaluate();
-    return std::all_of(data_.begin(), data_.end(), predicate);
+template <typename Predicate>
+bool MyRange<T>::All(Predicate predicate) const {
+    std::atomic<bool> failed(false);
+    ForEachChunk([&](const T& value) {
+        if (failed.load(std::memory_order_relaxed)) return false;
+        if (predicate(value)) return true;
+        failed.store(true, std::memory_order_relaxed);
+        return false;
+    });
+    return !failed.load();
 }
 
 // Implementation of Any operation
 template <typename T>
-bool MyRange<T>::Any(std::function<bool(T)> predicate) const {
-    Evaluate();
-    return std::any_of(data_.begin(), data_.end(), predicate);
+template <typename Predicate>
+bool MyRange<T>::Any(Predicate predicate) const {
+    std::atomic<bool> found(false);
+    ForEachChunk([&](const T& value) {
+        if (found.load(std::memory_order_relaxed)) return false;
+        if (!predicate(value)) return true;
+        found.store(true, std::memory_order_relaxed);
+        return false;
+    });
+    return found.load();
 }
 
 // Implementation of Sum operation
 template <typename T>
 T MyRange<T>::Sum() const {
-    Evaluate();
-    return std::accumulate(data_.begin(), data_.end(), T(0));
+    auto add = [](T& sum, const T& value) { sum = sum + value; return true; };
+    std::vector<T> sums;
+    if constexpr (IsSimdType<T>::value) {
+        sums = FoldChunks(T(0), add, [](T& sum, const T* values, size_t count) { sum = sum + SimdSum(values, count); });
+    } else {
+        sums = FoldChunks(T(0), add);
+    }
+    T sum = T(0);
+    for (const auto& chunkSum : sums) sum = sum + chunkSum;
+    return sum;
 }
 
 // Implementation of Average operation
 template <typename T>
 double MyRange<T>::Average() const {
-    Evaluate();
-    if (data_.empty()) return 0;
-    return static_cast<double>(Sum()) / data_.size();
+    using Partial = std::pair<T, size_t>;
+    auto add = [](Partial& partial, const T& value) {
+        partial.first = partial.first + value;
+        ++partial.second;
+        return true;
+    };
+    std::vector<Partial> partials;
+    if constexpr (IsSimdType<T>::value) {
+        partials = FoldChunks(Partial(T(0), 0), add, [](Partial& partial, const T* values, size_t count) {
+            partial.first = partial.first + SimdSum(values, count);
+            partial.second += count;
+        });
+    } else {
+        partials = FoldChunks(Partial(T(0), 0), add);
+    }
+    T sum = T(0);
+    size_t count = 0;
+    for (const auto& partial : partials) {
+        sum = sum + partial.first;
+        count += partial.second;
+    }
+    if (count == 0) return 0;
+    return static_cast<double>(sum) / count;
 }
 
 // Implementation of Min operation
 template <typename T>
 T MyRange<T>::Min() const {
-    Evaluate();
-    if (data_.empty()) throw std::logic_error("Empty range");
-    return *std::min_element(data_.begin(), data_.end());
+    if constexpr (IsSimdType<T>::value) return MinMax().first;
+    auto mins = FoldChunks(std::optional<T>(), [](std::optional<T>& min, const T& value) {
+        if (!min || value < *min) min = value;
+        return true;
+    });
+    std::optional<T> min;
+    for (const auto& chunkMin : mins) {
+        if (chunkMin && (!min || *chunkMin < *min)) min = chunkMin;
+    }
+    if (!min) throw std::logic_error("Empty range");
+    return *min;
 }
 
 // Implementation of Max operation
 template <typename T>
 T MyRange<T>::Max() const {
-    Evaluate();
-    if (data_.empty()) throw std::logic_error("Empty range");
-    return *std::max_element(data_.begin(), data_.end());
+    if constexpr (IsSimdType<T>::value) return MinMax().second;
+    auto maxes = FoldChunks(std::optional<T>(), [](std::optional<T>& max, const T& value) {
+        if (!max || *max < value) max = value;
+        return true;
+    });
+    std::optional<T> max;
+    for (const auto& chunkMax : maxes) {
+        if (chunkMax && (!max || *max < *chunkMax)) max = chunkMax;
+    }
+    if (!max) throw std::logic_error("Empty range");
+    return *max;
+}
+
+// Implementation of MinMax operation
+template <typename T>
+std::pair<T, T> MyRange<T>::MinMax() const {
+    using Partial = std::optional<std::pair<T, T>>;
+    auto merge = [](Partial& partial, const T& low, const T& high) {
+        if (!partial) {
+            partial = std::make_pair(low, high);
+        } else {
+            if (low < partial->first) partial->first = low;
+            if (partial->second < high) partial->second = high;
+        }
+    };
+    auto add = [merge](Partial& partial, const T& value) { merge(partial, value, value); return true; };
+    std::vector<Partial> partials;
+    if constexpr (IsSimdType<T>::value) {
+        partials = FoldChunks(Partial(), add, [merge](Partial& partial, const T* values, size_t count) {
+            if (count == 0) return;
+            const auto batch = SimdMinMax(values, count);
+            merge(partial, batch.first, batch.second);
+        });
+    } else {
+        partials = FoldChunks(Partial(), add);
+    }
+    Partial result;
+    for (const auto& partial : partials) {
+        if (partial) merge(result, partial->first, partial->second);
+    }
+    if (!result) throw std::logic_error("Empty range");
+    return *result;
 }
 
 // Implementation of Count operation
 template <typename T>
 size_t MyRange<T>::Count() const {
-    Evaluate();
-    return data_.size();
+    if (IsBuffered()) return Data().size();
+    MyRange<T> counted = *this;
+    counted.operations_ = CountPlan(operations_);
+    // A trailing Distinct counts the keys it inserts instead of passing elements on
+    if (!counted.operations_.empty()) {
+        auto counter = counted.operations_.back();
+        size_t count = 0;
+        if (auto sink = counter->WrapCounter(count)) {
+            counted.operations_.pop_back();
+            counted.Run(*sink);
+            return count;
+        }
+    }
+    if (counted.IsBuffered()) return counted.Data().size();
+    if (counted.operations_.empty()) {
+        if (auto count = source_->Count()) return *count;
+    }
+    auto counts = counted.FoldChunks(size_t(0), [](size_t& count, const T&) { ++count; return true; });
+    return std::accumulate(counts.begin(), counts.end(), size_t(0));
 }
 
 // Implementation of Contains operation
 template <typename T>
 bool MyRange<T>::Contains(const T& value) const {
-    Evaluate();
-    return std::find(data_.begin(), data_.end(), value) != data_.end();
+    if constexpr (IsSimdType<T>::value) {
+        if (IsBuffered()) {
+            auto found = FoldBuffer([&](const T* data, size_t count) { return static_cast<char>(SimdContains(data, count, value)); });
+            return std::find(found.begin(), found.end(), char(1)) != found.end();
+        }
+    }
+    return Any([&](const T& item) { return item == value; });
 }
 
 // Implementation of ElementAt operation
 template <typename T>
 T MyRange<T>::ElementAt(size_t index) const {
-    Evaluate();
-    if (index >= data_.size()) throw std::out_of_range("Index out of range");
-    return data_[index];
+    auto ordering = TrailingOrdering();
+    if (ordering && index < SIZE_MAX && ordering->Limit() > index + 1) return Take(index + 1).ElementAt(index);
+    std::optional<T> element;
+    size_t position = 0;
+    ForEach([&](const T& value) {
+        if (position++ < index) return true;
+        element = value;
+        return false;
+    });
+    if (!element) throw std::out_of_range("Index out of range");
+    return *element;
+}
+
+// Implementation of First operation
+template <typename T>
+T MyRange<T>::First() const {
+    auto ordering = TrailingOrdering();
+    if (ordering && ordering->Limit() > 1) return Take(1).First();
+    std::optional<T> first;
+    ForEach([&](const T& value) {
+        first = value;
+        return false;
+    });
+    if (!first) throw std::logic_error("Empty range");
+    return *first;
+}
+
+// Implementation of the multi-aggregate Aggregate operation
+template <typename T>
+template <typename... Aggregators, typename>
+std::tuple<AggregatorResult<Aggregators, T>...> MyRange<T>::Aggregate(Aggregators...) const {
+    using States = AggregatorStates<T, Aggregators...>;
+    auto chunks = FoldChunks(States(), [](States& states, const T& value) { states.Fold(value); return true; });
+    for (size_t i = 1; i < chunks.size(); ++i) chunks.front().Combine(chunks[i]);
+    return chunks.front().Finish();
+}
+
+// Implementation of the seeded Aggregate operation
+template <typename T>
+template <typename Seed, typename Func, typename>
+Seed MyRange<T>::Aggregate(Seed seed, Func func) const {
+    ForEach([&](const T& value) { seed = func(std::move(seed), value); return true; });
+    return seed;
+}
+
+// Implementation of Stats operation
+template <typename T>
+RangeStats<T> MyRange<T>::Stats() const {
+    using States = AggregatorStates<T, CountAggregator, SumAggregator, MinAggregator, MaxAggregator>;
+    auto chunks = FoldChunks(States(), [](States& states, const T& value) { states.Fold(value); return true; });
+    for (size_t i = 1; i < chunks.size(); ++i) chunks.front().Combine(chunks[i]);
+    RangeStats<T> stats;
+    const auto& states = chunks.front().States();
+    stats.count = std::get<0>(states);
+    if (stats.count == 0) return stats;
+    stats.sum = std::get<1>(states);
+    stats.min = *std::get<2>(states);
+    stats.max = *std::get<3>(states);
+    stats.average = static_cast<double>(stats.sum) / stats.count;
+    return stats;
+}
+
+// Implementation of MinBy operation
+template <typename T>
+template <typename KeySelector>
+T MyRange<T>::MinBy(KeySelector keySelector) const {
+    return BestBy(keySelector, [](const auto& candidate, const auto& current) { return candidate < current; });
+}
+
+// Implementation of MaxBy operation
+template <typename T>
+template <typename KeySelector>
+T MyRange<T>::MaxBy(KeySelector keySelector) const {
+    return BestBy(keySelector, [](const auto& candidate, const auto& current) { return current < candidate; });
+}
+
+// Implementation of the shared MinBy/MaxBy fold; each key is computed once
+template <typename T>
+template <typename KeySelector, typename Better>
+T MyRange<T>::BestBy(KeySelector keySelector, Better better) const {
+    using KeyType = std::decay_t<decltype(keySelector(std::declval<const T&>()))>;
+    using Candidate = std::optional<std::pair<KeyType, T>>;
+    auto partials = FoldChunks(Candidate(), [&](Candidate& best, const T& value) {
+        auto key = keySelector(value);
+        if (!best || better(key, best->first)) best.emplace(std::move(key), value);
+        return true;
+    });
+    Candidate best;
+    for (auto& partial : partials) {
+        if (partial && (!best || better(partial->first, best->first))) best = std::move(partial);
+    }
+    if (!best) throw std::logic_error("Empty range");
+    return best->second;
 }
 
 // Implementation of ToSet operation
 template <typename T>
-std::set<T> MyRange<T>::ToSet() const {
+std::set<T> MyRange<T>::ToSet() const& {
     Evaluate();
-    return std::set<T>(data_.begin(), data_.end());
+    return std::set<T>(Data().begin(), Data().end());
 }
 
-// Implementation of ToList operation
 template <typename T>
-std::vector<T> MyRange<T>::ToList() const {
+std::set<T> MyRange<T>::ToSet() && {
     Evaluate();
-    return data_;
+    if (!OwnsBuffer()) return std::set<T>(Data().begin(), Data().end());
+    return std::set<T>(std::make_move_iterator(data_->begin()), std::make_move_iterator(data_->end()));
+}
+
+// Implementation of ToList operation
+template <typename T>
+std::vector<T> MyRange<T>::ToList() const& {
+    return ToVector();
+}
+
+template <typename T>
+std::vector<T> MyRange<T>::ToList() && {
+    return std::move(*this).ToVector();
 }
 
 // Implementation of ToDeque operation
 template <typename T>
-std::deque<T> MyRange<T>::ToDeque() const {
+std::deque<T> MyRange<T>::ToDeque() const& {
+    Evaluate();
+    return std::deque<T>(Data().begin(), Data().end());
+}
+
+template <typename T>
+std::deque<T> MyRange<T>::ToDeque() && {
     Evaluate();
-    return std::deque<T>(data_.begin(), data_.end());
+    if (!OwnsBuffer()) return std::deque<T>(Data().begin(), Data().end());
+    return std::deque<T>(std::make_move_iterator(data_->begin()), std::make_move_iterator(data_->end()));
 }
 
 // Implementation of ToVector operation
 template <typename T>
-std::vector<T> MyRange<T>::ToVector() const {
+std::vector<T> MyRange<T>::ToVector() const& {
+    Evaluate();
+    return Data();
+}
+
+template <typename T>
+std::vector<T> MyRange<T>::ToVector() && {
     Evaluate();
-    return data_;
+    if (!OwnsBuffer()) return Data();
+    return std::move(*data_);
+}
+
+// Implementation of View
+template <typename T>
+template <typename Container>
+MyRange<T> MyRange<T>::View(const Container& container) {
+    static_assert(std::is_same<std::decay_t<decltype(*std::begin(container))>, T>::value, "View requires a container of T");
+    return View(container, IdentitySelector());
 }
 
+template <typename T>
+template <typename Container, typename Project>
+MyRange<T> MyRange<T>::View(const Container& container, Project project) {
+    MyRange<T> result;
+    result.source_ = ArenaShared<ViewSource<T, Container, Project>>(container, project);
+    return result;
+}
 
 // Implementation of AddPrefix operation for std::string
 template <typename T>
 MyRange<T> MyRange<T>::AddPrefix(const std::string& prefix) const {
     static_assert(std::is_same<T, std::string>::value, "AddPrefix is only supported for std::string type");
-    return Select([prefix](const std::string& value) { return prefix + value; });
+    return Select([prefix](const std::string& value) {
+        std::string result;
+        result.reserve(prefix.size() + value.size());
+        result.append(prefix).append(value);
+        return result;
+    });
 }
 
 // Implementation of AddSuffix operation for std::string
 template <typename T>
 MyRange<T> MyRange<T>::AddSuffix(const std::string& suffix) const {
     static_assert(std::is_same<T, std::string>::value, "AddSuffix is only supported for std::string type");
-    return Select([suffix](const std::string& value) { return value + suffix; });
+    return Select([suffix](const std::string& value) {
+        std::string result;
+        result.reserve(value.size() + suffix.size());
+        result.append(value).append(suffix);
+        return result;
+    });
 }
 
 // Implementation of ToUpperCase operation for std::string
@@ -222,7 +1047,7 @@ MyRange<T> MyRange<T>::ToUpperCase() const {
     static_assert(std::is_same<T, std::string>::value, "ToUpperCase is only supported for std::string type");
     return Select([](const std::string& value) {
         std::string result = value;
-        std::transform(result.begin(), result.end(), result.begin(), ::toupper);
+        SimdAsciiCase(result.data(), result.size(), true);
         return result;
     });
 }
@@ -233,7 +1058,7 @@ MyRange<T> MyRange<T>::ToLowerCase() const {
     static_assert(std::is_same<T, std::string>::value, "ToLowerCase is only supported for std::string type");
     return Select([](const std::string& value) {
         std::string result = value;
-        std::transform(result.begin(), result.end(), result.begin(), ::tolower);
+        SimdAsciiCase(result.data(), result.size(), false);
         return result;
     });
 }
@@ -0,0 +1,324 @@
+#ifndef SSBESB_LAIC_LIVE_H
+#define SSBESB_LAIC_LIVE_H
+
+#include "laic.h"
+
+template <typename T>
+class LiveQuery;
+
+// Append-only source for incrementally maintained queries. Aggregates built from its Where and
+// Select chains remember how far into the source they have read, and each read folds in only
+// the elements appended since. Not synchronized: appends and reads must not overlap
+template <typename T>
+class LiveRange {
+public:
+    LiveRange() : data_(std::make_shared<std::vector<T>>()) {}
+
+    LiveRange(const LiveRange&) = delete;
+    LiveRange& operator=(const LiveRange&) = delete;
+
+    void Append(const T& value) { data_->push_back(value); }
+    void Append(const std::vector<T>& batch) { data_->insert(data_->end(), batch.begin(), batch.end()); }
+
+    size_t Size() const { return data_->size(); }
+
+    // Copy of the elements appended so far
+    MyRange<T> Snapshot() const { return MyRange<T>(std::vector<T>(*data_)); }
+
+    // Query over every element, including those appended later
+    LiveQuery<T> Query() const {
+        MyRange<T> range;
+        range.data_ = data_;
+        return LiveQuery<T>(range);
+    }
+
+    template <typename Predicate>
+    LiveQuery<T> Where(Predicate predicate) const { return Query().Where(predicate); }
+
+    template <typename Selector>
+    auto Select(Selector selector) const { return Query().Select(selector); }
+
+private:
+    // Shared with the ranges of its queries, which read it by position
+    std::shared_ptr<std::vector<T>> data_;
+};
+
+// Incrementally maintained result of a query: state is folded with fold(state, element) over
+// the source positions not consumed yet, and finish(state) yields the result
+template <typename T, typename State, typename Fold, typename Finish>
+class LiveAggregate {
+public:
+    LiveAggregate(const MyRange<T>& range, State state, Fold fold, Finish finish)
+        : range_(range), state_(std::move(state)), fold_(fold), finish_(finish) {}
+
+    // Folds in the elements appended since the last read and returns the result
+    decltype(auto) Value() {
+        Update();
+        return finish_(static_cast<const State&>(state_));
+    }
+
+    void Update() {
+        const size_t size = range_.SourceSize();
+        if (consumed_ == size) return;
+        range_.ForEach([this](const T& value) { fold_(state_, value); return true; }, consumed_, size);
+        consumed_ = size;
+    }
+
+    // Number of source elements folded in so far
+    size_t Consumed() const { return consumed_; }
+
+private:
+    MyRange<T> range_;
+    size_t consumed_ = 0;
+    State state_;
+    Fold fold_;
+    Finish finish_;
+};
+
+template <typename T, typename State, typename Fold, typename Finish>
+LiveAggregate<T, State, Fold, Finish> MakeLiveAggregate(const MyRange<T>& range, State state, Fold fold, Finish finish) {
+    return LiveAggregate<T, State, Fold, Finish>(range, std::move(state), fold, finish);
+}
+
+template <typename T, typename KeySelector>
+class LiveGrouping;
+
+// Elementwise query over a LiveRange. Only Where and Select are offered, so the query of any
+// slice of the source is the matching slice of the result
+template <typename T>
+class LiveQuery {
+public:
+    explicit LiveQuery(const MyRange<T>& range) : range_(range) {}
+
+    template <typename Predicate>
+    LiveQuery Where(Predicate predicate) const { return LiveQuery(range_.Where(predicate)); }
+
+    template <typename Selector>
+    auto Select(Selector selector) const -> LiveQuery<decltype(selector(std::declval<T>()))> {
+        return LiveQuery<decltype(selector(std::declval<T>()))>(range_.Select(selector));
+    }
+
+    // Aggregates over all elements, kept up to date as the source grows
+    auto Count() const;
+    auto Sum() const;
+    auto Min() const;
+    auto Max() const;
+    auto Average() const;
+
+    // Distinct elements in order of first appearance
+    auto Distinct() const;
+
+    // Folds every element as seed = func(seed, element)
+    template <typename Seed, typename Func>
+    auto Aggregate(Seed seed, Func func) const;
+
+    template <typename KeySelector>
+    LiveGrouping<T, KeySelector> GroupBy(KeySelector keySelector) const { return LiveGrouping<T, KeySelector>(range_, keySelector); }
+
+private:
+    MyRange<T> range_;
+};
+
+// Per-key aggregates of a LiveQuery, as vectors of (key, result) in order of first appearance
+template <typename T, typename KeySelector>
+class LiveGrouping {
+public:
+    using KeyType = std::decay_t<decltype(std::declval<KeySelector&>()(std::declval<const T&>()))>;
+
+    LiveGrouping(const MyRange<T>& range, KeySelector keySelector) : range_(range), keySelector_(keySelector) {}
+
+    auto Count() const;
+
+    template <typename Selector>
+    auto Sum(Selector selector) const;
+
+    template <typename Selector>
+    auto Average(Selector selector) const;
+
+    template <typename Selector>
+    auto Min(Selector selector) const;
+
+    template <typename Selector>
+    auto Max(Selector selector) const;
+
+    template <typename Seed, typename Func>
+    auto Aggregate(Seed seed, Func func) const;
+
+private:
+    // Groups whose accumulator is created by start(element) for the first element of the key
+    // and updated by fold(accumulator, element) for the rest
+    template <typename Acc, typename Start, typename Fold, typename Finish>
+    auto FoldGroups(Start start, Fold fold, Finish finish) const;
+
+    template <typename Acc, typename Start, typename Fold>
+    auto FoldGroups(Start start, Fold fold) const {
+        return FoldGroups<Acc>(start, fold, [](const std::vector<std::pair<KeyType, Acc>>& groups) -> const auto& { return groups; });
+    }
+
+    MyRange<T> range_;
+    KeySelector keySelector_;
+};
+
+// Implementation of LiveQuery Count aggregate
+template <typename T>
+auto LiveQuery<T>::Count() const {
+    return MakeLiveAggregate(range_, size_t(0),
+        [](size_t& count, const T&) { ++count; },
+        [](const size_t& count) { return count; });
+}
+
+// Implementation of LiveQuery Sum aggregate
+template <typename T>
+auto LiveQuery<T>::Sum() const {
+    return MakeLiveAggregate(range_, T(0),
+        [](T& sum, const T& value) { sum = sum + value; },
+        [](const T& sum) { return sum; });
+}
+
+// Implementation of LiveQuery Min aggregate
+template <typename T>
+auto LiveQuery<T>::Min() const {
+    return MakeLiveAggregate(range_, std::optional<T>(),
+        [](std::optional<T>& min, const T& value) { if (!min || value < *min) min = value; },
+        [](const std::optional<T>& min) {
+            if (!min) throw std::logic_error("Empty range");
+            return *min;
+        });
+}
+
+// Implementation of LiveQuery Max aggregate
+template <typename T>
+auto LiveQuery<T>::Max() const {
+    return MakeLiveAggregate(range_, std::optional<T>(),
+        [](std::optional<T>& max, const T& value) { if (!max || *max < value) max = value; },
+        [](const std::optional<T>& max) {
+            if (!max) throw std::logic_error("Empty range");
+            return *max;
+        });
+}
+
+// Implementation of LiveQuery Average aggregate
+template <typename T>
+auto LiveQuery<T>::Average() const {
+    return MakeLiveAggregate(range_, std::make_pair(T(0), size_t(0)),
+        [](std::pair<T, size_t>& partial, const T& value) { partial.first = partial.first + value; ++partial.second; },
+        [](const std::pair<T, size_t>& partial) {
+            return partial.second == 0 ? 0.0 : static_cast<double>(partial.first) / partial.second;
+        });
+}
+
+// Implementation of LiveQuery Distinct operation
+template <typename T>
+auto LiveQuery<T>::Distinct() const {
+    struct State {
+        DistinctSet<T> seen;
+        std::vector<T> values;
+    };
+    return MakeLiveAggregate(range_, State(),
+        [](State& state, const T& value) { if (state.seen.Insert(value)) state.values.push_back(value); },
+        [](const State& state) -> const std::vector<T>& { return state.values; });
+}
+
+// Implementation of LiveQuery Aggregate operation
+template <typename T>
+template <typename Seed, typename Func>
+auto LiveQuery<T>::Aggregate(Seed seed, Func func) const {
+    return MakeLiveAggregate(range_, std::move(seed),
+        [func](Seed& accumulator, const T& value) { accumulator = func(accumulator, value); },
+        [](const Seed& accumulator) -> const Seed& { return accumulator; });
+}
+
+template <typename T, typename KeySelector>
+template <typename Acc, typename Start, typename Fold, typename Finish>
+auto LiveGrouping<T, KeySelector>::FoldGroups(Start start, Fold fold, Finish finish) const {
+    struct Table {
+        KeyIndex<KeyType> index;
+        std::vector<std::pair<KeyType, Acc>> groups;
+    };
+    auto keySelector = keySelector_;
+    return MakeLiveAggregate(range_, Table(),
+        [keySelector, start, fold](Table& table, const T& value) {
+            KeyType key = keySelector(value);
+            auto slot = table.index.Insert(key);
+            if (slot.second) {
+                table.groups.emplace_back(std::move(key), start(value));
+            } else {
+                fold(table.groups[slot.first].second, value);
+            }
+        },
+        [finish](const Table& table) -> decltype(auto) { return finish(table.groups); });
+}
+
+// Implementation of LiveGrouping Count aggregate
+template <typename T, typename KeySelector>
+auto LiveGrouping<T, KeySelector>::Count() const {
+    return FoldGroups<size_t>(
+        [](const T&) { return size_t(1); },
+        [](size_t& count, const T&) { ++count; });
+}
+
+// Implementation of LiveGrouping Sum aggregate
+template <typename T, typename KeySelector>
+template <typename Selector>
+auto LiveGrouping<T, KeySelector>::Sum(Selector selector) const {
+    using Result = std::decay_t<decltype(selector(std::declval<const T&>()))>;
+    return FoldGroups<Result>(
+        [selector](const T& value) { return Result(selector(value)); },
+        [selector](Result& sum, const T& value) { sum = sum + selector(value); });
+}
+
+// Implementation of LiveGrouping Average aggregate
+template <typename T, typename KeySelector>
+template <typename Selector>
+auto LiveGrouping<T, KeySelector>::Average(Selector selector) const {
+    using Result = std::decay_t<decltype(selector(std::declval<const T&>()))>;
+    using Partial = std::pair<Result, size_t>;
+    return FoldGroups<Partial>(
+        [selector](const T& value) { return Partial(selector(value), 1); },
+        [selector](Partial& partial, const T& value) { partial.first = partial.first + selector(value); ++partial.second; },
+        [](const std::vector<std::pair<KeyType, Partial>>& groups) {
+            std::vector<std::pair<KeyType, double>> averages;
+            averages.reserve(groups.size());
+            for (const auto& group : groups) {
+                averages.emplace_back(group.first, static_cast<double>(group.second.first) / group.second.second);
+            }
+            return averages;
+        });
+}
+
+// Implementation of LiveGrouping Min aggregate
+template <typename T, typename KeySelector>
+template <typename Selector>
+auto LiveGrouping<T, KeySelector>::Min(Selector selector) const {
+    using Result = std::decay_t<decltype(selector(std::declval<const T&>()))>;
+    return FoldGroups<Result>(
+        [selector](const T& value) { return Result(selector(value)); },
+        [selector](Result& min, const T& value) {
+            Result candidate = selector(value);
+            if (candidate < min) min = std::move(candidate);
+        });
+}
+
+// Implementation of LiveGrouping Max aggregate
+template <typename T, typename KeySelector>
+template <typename Selector>
+auto LiveGrouping<T, KeySelector>::Max(Selector selector) const {
+    using Result = std::decay_t<decltype(selector(std::declval<const T&>()))>;
+    return FoldGroups<Result>(
+        [selector](const T& value) { return Result(selector(value)); },
+        [selector](Result& max, const T& value) {
+            Result candidate = selector(value);
+            if (max < candidate) max = std::move(candidate);
+        });
+}
+
+// Implementation of LiveGrouping Aggregate operation
+template <typename T, typename KeySelector>
+template <typename Seed, typename Func>
+auto LiveGrouping<T, KeySelector>::Aggregate(Seed seed, Func func) const {
+    return FoldGroups<Seed>(
+        [seed, func](const T& value) { return Seed(func(seed, value)); },
+        [func](Seed& accumulator, const T& value) { accumulator = func(accumulator, value); });
+}
+
+#endif // SSBESB_LAIC_LIVE_H
@@ -0,0 +1,136 @@
+#ifndef SSBESB_LAIC_MEMORY_H
+#define SSBESB_LAIC_MEMORY_H
+
+#include <cstddef>
+#include <memory>
+#include <memory_resource>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+// Innermost resource installed on this thread by an ArenaScope, or null
+inline std::pmr::memory_resource*& InstalledResource() {
+    static thread_local std::pmr::memory_resource* resource = nullptr;
+    return resource;
+}
+
+// Resource that query intermediates allocated on this thread come from
+inline std::pmr::memory_resource* CurrentResource() {
+    std::pmr::memory_resource* resource = InstalledResource();
+    return resource ? resource : std::pmr::get_default_resource();
+}
+
+// Installs a memory resource for the intermediates of queries run on this thread: operation
+// nodes, evaluation stages, hash tables and sort buffers. Without a resource of its own the
+// scope owns a monotonic arena that is released in one shot when the scope ends. Ranges built
+// inside the scope must not outlive it; materialized results (ToVector, iteration) are
+// allocated normally. Parallel chunks run on other threads and use the default resource
+class ArenaScope {
+public:
+    explicit ArenaScope(std::pmr::memory_resource& resource) : previous_(InstalledResource()) {
+        InstalledResource() = &resource;
+    }
+    explicit ArenaScope(size_t initialSize = 64 * 1024)
+        : arena_(std::make_unique<std::pmr::monotonic_buffer_resource>(initialSize)), previous_(InstalledResource()) {
+        InstalledResource() = arena_.get();
+    }
+    ~ArenaScope() { InstalledResource() = previous_; }
+
+    ArenaScope(const ArenaScope&) = delete;
+    ArenaScope& operator=(const ArenaScope&) = delete;
+
+private:
+    std::unique_ptr<std::pmr::monotonic_buffer_resource> arena_;
+    std::pmr::memory_resource* previous_;
+};
+
+// Scope allocating query intermediates from resource, e.g. auto arena = WithArena(pool);
+inline ArenaScope WithArena(std::pmr::memory_resource& resource) { return ArenaScope(resource); }
+
+// Scope allocating query intermediates from its own monotonic arena
+inline ArenaScope WithArena(size_t initialSize = 64 * 1024) { return ArenaScope(initialSize); }
+
+// Allocator bound to the current resource when default constructed, so containers declared
+// without arguments pick up the enclosing ArenaScope. Copies of a container follow the
+// resource of the copying thread, and the allocator moves with the container's storage
+template <typename T>
+class ArenaAllocator {
+public:
+    using value_type = T;
+    using propagate_on_container_move_assignment = std::true_type;
+    using propagate_on_container_swap = std::true_type;
+
+    ArenaAllocator() noexcept : resource_(CurrentResource()) {}
+    explicit ArenaAllocator(std::pmr::memory_resource* resource) noexcept : resource_(resource) {}
+    template <typename U>
+    ArenaAllocator(const ArenaAllocator<U>& other) noexcept : resource_(other.Resource()) {}
+
+    T* allocate(size_t count) {
+        if (count > SIZE_MAX / sizeof(T)) throw std::bad_array_new_length();
+        return static_cast<T*>(resource_->allocate(count * sizeof(T), alignof(T)));
+    }
+    void deallocate(T* pointer, size_t count) noexcept {
+        resource_->deallocate(pointer, count * sizeof(T), alignof(T));
+    }
+
+    ArenaAllocator select_on_container_copy_construction() const { return ArenaAllocator(); }
+
+    std::pmr::memory_resource* Resource() const noexcept { return resource_; }
+
+    template <typename U>
+    bool operator==(const ArenaAllocator<U>& other) const noexcept {
+        return resource_ == other.Resource() || resource_->is_equal(*other.Resource());
+    }
+    template <typename U>
+    bool operator!=(const ArenaAllocator<U>& other) const noexcept { return !(*this == other); }
+
+private:
+    std::pmr::memory_resource* resource_;
+};
+
+template <typename T>
+using ArenaVector = std::vector<T, ArenaAllocator<T>>;
+
+// Deleter returning an object created by ArenaNew to the resource it came from
+class ArenaDeleter {
+public:
+    ArenaDeleter() = default;
+    ArenaDeleter(std::pmr::memory_resource* resource, size_t size, size_t alignment)
+        : resource_(resource), size_(size), alignment_(alignment) {}
+
+    template <typename T>
+    void operator()(T* object) const {
+        object->~T();
+        resource_->deallocate(object, size_, alignment_);
+    }
+
+private:
+    std::pmr::memory_resource* resource_ = nullptr;
+    size_t size_ = 0;
+    size_t alignment_ = 0;
+};
+
+// Owning pointer to an object allocated from a memory resource; converts to base class pointers
+template <typename T>
+using ArenaPtr = std::unique_ptr<T, ArenaDeleter>;
+
+template <typename T, typename... Args>
+ArenaPtr<T> ArenaNew(Args&&... args) {
+    std::pmr::memory_resource* resource = CurrentResource();
+    void* memory = resource->allocate(sizeof(T), alignof(T));
+    try {
+        return ArenaPtr<T>(new (memory) T(std::forward<Args>(args)...), ArenaDeleter(resource, sizeof(T), alignof(T)));
+    } catch (...) {
+        resource->deallocate(memory, sizeof(T), alignof(T));
+        throw;
+    }
+}
+
+// Shared object whose storage and control block come from the current resource
+template <typename T, typename... Args>
+std::shared_ptr<T> ArenaShared(Args&&... args) {
+    return std::allocate_shared<T>(ArenaAllocator<T>(), std::forward<Args>(args)...);
+}
+
+#endif // SSBESB_LAIC_MEMORY_H
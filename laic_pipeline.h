@@ -0,0 +1,513 @@
+#ifndef SSBESB_LAIC_PIPELINE_H
+#define SSBESB_LAIC_PIPELINE_H
+
+#include "laic.h"
+
+// Execution mode of the range a pipeline starts from, given back to the range it ends in
+struct ExecutionMode {
+    bool parallel = false;
+    size_t parallelThreshold = 0;
+};
+
+// Producer streaming the elements of a MyRange, including its pending operations. Every
+// producer's ForEach takes the positions [first, last) of this root range to read; a narrower
+// slice than the whole is only asked of producers that report IsPartitionable
+template <typename T>
+class RangeProducer {
+public:
+    RangeProducer(const MyRange<T>& range) : range_(range) {}
+    template <typename Consumer>
+    void ForEach(Consumer&& consumer, size_t first = 0, size_t last = SIZE_MAX) const {
+        range_.ForEach([&](const T& value) { return consumer(value); }, first, last);
+    }
+    bool IsPartitionable() const { return range_.IsPartitionable(); }
+    size_t Size() const { return range_.SourceSize(); }
+    ExecutionMode Mode() const { return ExecutionMode{range_.parallel_, range_.parallelThreshold_}; }
+    // Owner of the storage the range's elements refer into, forwarded by every later stage
+    std::shared_ptr<const void> Pin() const { return range_.Pin(); }
+private:
+    MyRange<T> range_;
+};
+
+// Producer keeping the elements that satisfy a predicate
+template <typename Upstream, typename Func>
+class WhereProducer {
+public:
+    WhereProducer(const Upstream& upstream, Func predicate) : upstream_(upstream), predicate_(predicate) {}
+    template <typename Consumer>
+    void ForEach(Consumer&& consumer, size_t first = 0, size_t last = SIZE_MAX) const {
+        upstream_.ForEach([&](const auto& value) { return !predicate_(value) || consumer(value); }, first, last);
+    }
+    bool IsPartitionable() const { return upstream_.IsPartitionable(); }
+    size_t Size() const { return upstream_.Size(); }
+    ExecutionMode Mode() const { return upstream_.Mode(); }
+    std::shared_ptr<const void> Pin() const { return upstream_.Pin(); }
+private:
+    Upstream upstream_;
+    Func predicate_;
+};
+
+// Producer mapping each element through a selector
+template <typename Upstream, typename Func>
+class SelectProducer {
+public:
+    SelectProducer(const Upstream& upstream, Func selector) : upstream_(upstream), selector_(selector) {}
+    template <typename Consumer>
+    void ForEach(Consumer&& consumer, size_t first = 0, size_t last = SIZE_MAX) const {
+        upstream_.ForEach([&](const auto& value) { return consumer(selector_(value)); }, first, last);
+    }
+    bool IsPartitionable() const { return upstream_.IsPartitionable(); }
+    size_t Size() const { return upstream_.Size(); }
+    ExecutionMode Mode() const { return upstream_.Mode(); }
+    std::shared_ptr<const void> Pin() const { return upstream_.Pin(); }
+private:
+    Upstream upstream_;
+    Func selector_;
+};
+
+// Producer yielding the first count elements, stopping its upstream afterwards
+template <typename Upstream>
+class TakeProducer {
+public:
+    TakeProducer(const Upstream& upstream, size_t count) : upstream_(upstream), count_(count) {}
+    template <typename Consumer>
+    void ForEach(Consumer&& consumer, size_t first = 0, size_t last = SIZE_MAX) const {
+        size_t remaining = count_;
+        if (remaining == 0) return;
+        upstream_.ForEach([&](const auto& value) { return consumer(value) && --remaining > 0; }, first, last);
+    }
+    // Which elements are taken depends on all before them
+    bool IsPartitionable() const { return false; }
+    size_t Size() const { return upstream_.Size(); }
+    ExecutionMode Mode() const { return upstream_.Mode(); }
+    std::shared_ptr<const void> Pin() const { return upstream_.Pin(); }
+private:
+    Upstream upstream_;
+    size_t count_;
+};
+
+// Producer dropping the first count elements
+template <typename Upstream>
+class SkipProducer {
+public:
+    SkipProducer(const Upstream& upstream, size_t count) : upstream_(upstream), count_(count) {}
+    template <typename Consumer>
+    void ForEach(Consumer&& consumer, size_t first = 0, size_t last = SIZE_MAX) const {
+        size_t remaining = count_;
+        upstream_.ForEach([&](const auto& value) {
+            if (remaining > 0) {
+                --remaining;
+                return true;
+            }
+            return consumer(value);
+        }, first, last);
+    }
+    bool IsPartitionable() const { return false; }
+    size_t Size() const { return upstream_.Size(); }
+    ExecutionMode Mode() const { return upstream_.Mode(); }
+    std::shared_ptr<const void> Pin() const { return upstream_.Pin(); }
+private:
+    Upstream upstream_;
+    size_t count_;
+};
+
+// Producer passing on the first element seen for each key
+template <typename T, typename Upstream, typename KeySelector>
+class DistinctProducer {
+public:
+    DistinctProducer(const Upstream& upstream, KeySelector keySelector) : upstream_(upstream), keySelector_(keySelector) {}
+    template <typename Consumer>
+    void ForEach(Consumer&& consumer, size_t first = 0, size_t last = SIZE_MAX) const {
+        DistinctSet<std::decay_t<decltype(keySelector_(std::declval<const T&>()))>> seen;
+        upstream_.ForEach([&](const auto& value) { return !seen.Insert(keySelector_(value)) || consumer(value); }, first, last);
+    }
+    bool IsPartitionable() const { return false; }
+    size_t Size() const { return upstream_.Size(); }
+    ExecutionMode Mode() const { return upstream_.Mode(); }
+    std::shared_ptr<const void> Pin() const { return upstream_.Pin(); }
+private:
+    Upstream upstream_;
+    KeySelector keySelector_;
+};
+
+// Source exposing a pipeline to MyRange once type erasure is needed. Chains of Where and Select
+// over a partitionable range split over its positions, so the range can run in parallel
+template <typename T, typename Producer>
+class PipelineSource : public RangeSource<T> {
+public:
+    PipelineSource(const Producer& producer) : producer_(producer) {}
+    void Produce(Sink<T>& sink) const override { ProduceSlice(sink, 0, SIZE_MAX); }
+    bool IsPartitionable() const override { return producer_.IsPartitionable(); }
+    size_t Size() const override { return producer_.Size(); }
+    void ProduceSlice(Sink<T>& sink, size_t first, size_t last) const override {
+        producer_.ForEach([&](const T& value) { return sink.Push(value); }, first, last);
+    }
+    std::shared_ptr<const void> Pin() const override { return producer_.Pin(); }
+private:
+    Producer producer_;
+};
+
+// Statically typed chain of operations; every stage is part of the type, so
+// building it allocates nothing and evaluation compiles down to a single loop
+template <typename T, typename Producer>
+class Pipeline {
+public:
+    explicit Pipeline(const Producer& producer) : producer_(producer) {}
+
+    // Lazy operations fused into the pipeline type
+    template <typename Predicate>
+    auto Where(Predicate predicate) const -> Pipeline<T, WhereProducer<Producer, Predicate>>;
+
+    template <typename Selector>
+    auto Select(Selector selector) const -> Pipeline<decltype(selector(std::declval<T>())), SelectProducer<Producer, Selector>>;
+
+    Pipeline<T, TakeProducer<Producer>> Take(size_t count) const;
+    Pipeline<T, SkipProducer<Producer>> Skip(size_t count) const;
+    Pipeline<T, DistinctProducer<T, Producer, IdentitySelector>> Distinct() const;
+
+    template <typename KeySelector>
+    Pipeline<T, DistinctProducer<T, Producer, KeySelector>> DistinctBy(KeySelector keySelector) const;
+
+    // Operations that buffer their input continue on the type-erased range
+    MyRange<T> Concat(const MyRange<T>& other) const { return ToRange().Concat(other); }
+    MyRange<T> Reverse() const { return ToRange().Reverse(); }
+
+    template <typename KeySelector>
+    MyRange<T> OrderBy(KeySelector keySelector) const { return ToRange().OrderBy(keySelector); }
+
+    template <typename KeySelector>
+    MyRange<T> OrderByDescending(KeySelector keySelector) const { return ToRange().OrderByDescending(keySelector); }
+
+    template <typename KeySelector>
+    GroupedRange<T, KeySelector> GroupBy(KeySelector keySelector) const { return ToRange().GroupBy(keySelector); }
+
+    template <typename Inner, typename OuterKey, typename InnerKey, typename ResultSelector>
+    auto Join(const MyRange<Inner>& inner, OuterKey outerKey, InnerKey innerKey, ResultSelector resultSelector) const {
+        return ToRange().Join(inner, outerKey, innerKey, resultSelector);
+    }
+
+    template <typename Inner, typename OuterKey, typename InnerKey, typename ResultSelector>
+    auto GroupJoin(const MyRange<Inner>& inner, OuterKey outerKey, InnerKey innerKey, ResultSelector resultSelector) const {
+        return ToRange().GroupJoin(inner, outerKey, innerKey, resultSelector);
+    }
+
+    MyRange<T> Intersect(const MyRange<T>& other) const { return ToRange().Intersect(other); }
+    MyRange<T> Except(const MyRange<T>& other) const { return ToRange().Except(other); }
+    MyRange<T> Union(const MyRange<T>& other) const { return ToRange().Union(other); }
+    MyRange<T> Memoize() const { return ToRange().Memoize(); }
+    MyRange<T> Cache() const { return ToRange().Memoize(); }
+
+    // Immediate operations
+    template <typename Predicate>
+    bool All(Predicate predicate) const;
+    template <typename Predicate>
+    bool Any(Predicate predicate) const;
+    T Sum() const;
+    double Average() const;
+    T Min() const;
+    T Max() const;
+    std::pair<T, T> MinMax() const;
+    size_t Count() const;
+    bool Contains(const T& value) const;
+    T ElementAt(size_t index) const;
+    T First() const;
+
+    template <typename... Aggregators, typename = std::enable_if_t<AreAggregators<Aggregators...>>>
+    std::tuple<AggregatorResult<Aggregators, T>...> Aggregate(Aggregators... aggregators) const;
+    template <typename Seed, typename Func, typename = std::enable_if_t<!AreAggregators<Seed>>>
+    Seed Aggregate(Seed seed, Func func) const;
+    RangeStats<T> Stats() const;
+
+    template <typename KeySelector>
+    T MinBy(KeySelector keySelector) const;
+    template <typename KeySelector>
+    T MaxBy(KeySelector keySelector) const;
+
+    std::set<T> ToSet() const;
+    std::vector<T> ToList() const;
+    std::deque<T> ToDeque() const;
+    std::vector<T> ToVector() const;
+
+    // Conversion back to the type-erased range; stays lazy
+    MyRange<T> ToRange() const;
+    operator MyRange<T>() const { return ToRange(); }
+
+    // Stream elements to a callable returning false to stop early
+    template <typename Consumer>
+    void ForEach(Consumer&& consumer) const {
+        producer_.ForEach(consumer);
+    }
+
+private:
+    Producer producer_;
+};
+
+// Implementation of AsPipeline operation
+template <typename T>
+Pipeline<T, RangeProducer<T>> MyRange<T>::AsPipeline() const {
+    return Pipeline<T, RangeProducer<T>>(RangeProducer<T>(*this));
+}
+
+// Implementation of pipeline Where operation
+template <typename T, typename Producer>
+template <typename Predicate>
+auto Pipeline<T, Producer>::Where(Predicate predicate) const -> Pipeline<T, WhereProducer<Producer, Predicate>> {
+    return Pipeline<T, WhereProducer<Producer, Predicate>>(WhereProducer<Producer, Predicate>(producer_, predicate));
+}
+
+// Implementation of pipeline Select operation
+template <typename T, typename Producer>
+template <typename Selector>
+auto Pipeline<T, Producer>::Select(Selector selector) const -> Pipeline<decltype(selector(std::declval<T>())), SelectProducer<Producer, Selector>> {
+    using ResultType = decltype(selector(std::declval<T>()));
+    return Pipeline<ResultType, SelectProducer<Producer, Selector>>(SelectProducer<Producer, Selector>(producer_, selector));
+}
+
+// Implementation of pipeline Take operation
+template <typename T, typename Producer>
+Pipeline<T, TakeProducer<Producer>> Pipeline<T, Producer>::Take(size_t count) const {
+    return Pipeline<T, TakeProducer<Producer>>(TakeProducer<Producer>(producer_, count));
+}
+
+// Implementation of pipeline Skip operation
+template <typename T, typename Producer>
+Pipeline<T, SkipProducer<Producer>> Pipeline<T, Producer>::Skip(size_t count) const {
+    return Pipeline<T, SkipProducer<Producer>>(SkipProducer<Producer>(producer_, count));
+}
+
+// Implementation of pipeline Distinct operation
+template <typename T, typename Producer>
+Pipeline<T, DistinctProducer<T, Producer, IdentitySelector>> Pipeline<T, Producer>::Distinct() const {
+    return DistinctBy(IdentitySelector());
+}
+
+// Implementation of pipeline DistinctBy operation
+template <typename T, typename Producer>
+template <typename KeySelector>
+Pipeline<T, DistinctProducer<T, Producer, KeySelector>> Pipeline<T, Producer>::DistinctBy(KeySelector keySelector) const {
+    return Pipeline<T, DistinctProducer<T, Producer, KeySelector>>(DistinctProducer<T, Producer, KeySelector>(producer_, keySelector));
+}
+
+// Implementation of pipeline All operation
+template <typename T, typename Producer>
+template <typename Predicate>
+bool Pipeline<T, Producer>::All(Predicate predicate) const {
+    bool result = true;
+    ForEach([&](const T& value) { result = predicate(value); return result; });
+    return result;
+}
+
+// Implementation of pipeline Any operation
+template <typename T, typename Producer>
+template <typename Predicate>
+bool Pipeline<T, Producer>::Any(Predicate predicate) const {
+    bool result = false;
+    ForEach([&](const T& value) { result = predicate(value); return !result; });
+    return result;
+}
+
+// Implementation of pipeline Sum operation
+template <typename T, typename Producer>
+T Pipeline<T, Producer>::Sum() const {
+    T sum = T(0);
+    ForEach([&](const T& value) { sum = sum + value; return true; });
+    return sum;
+}
+
+// Implementation of pipeline Average operation
+template <typename T, typename Producer>
+double Pipeline<T, Producer>::Average() const {
+    T sum = T(0);
+    size_t count = 0;
+    ForEach([&](const T& value) { sum = sum + value; ++count; return true; });
+    if (count == 0) return 0;
+    return static_cast<double>(sum) / count;
+}
+
+// Implementation of pipeline Min operation
+template <typename T, typename Producer>
+T Pipeline<T, Producer>::Min() const {
+    std::optional<T> min;
+    ForEach([&](const T& value) {
+        if (!min || value < *min) min = value;
+        return true;
+    });
+    if (!min) throw std::logic_error("Empty range");
+    return *min;
+}
+
+// Implementation of pipeline Max operation
+template <typename T, typename Producer>
+T Pipeline<T, Producer>::Max() const {
+    std::optional<T> max;
+    ForEach([&](const T& value) {
+        if (!max || *max < value) max = value;
+        return true;
+    });
+    if (!max) throw std::logic_error("Empty range");
+    return *max;
+}
+
+// Implementation of pipeline MinMax operation
+template <typename T, typename Producer>
+std::pair<T, T> Pipeline<T, Producer>::MinMax() const {
+    std::optional<std::pair<T, T>> result;
+    ForEach([&](const T& value) {
+        if (!result) {
+            result = std::make_pair(value, value);
+        } else {
+            if (value < result->first) result->first = value;
+            if (result->second < value) result->second = value;
+        }
+        return true;
+    });
+    if (!result) throw std::logic_error("Empty range");
+    return *result;
+}
+
+// Implementation of pipeline Count operation
+template <typename T, typename Producer>
+size_t Pipeline<T, Producer>::Count() const {
+    size_t count = 0;
+    ForEach([&](const T&) { ++count; return true; });
+    return count;
+}
+
+// Implementation of pipeline multi-aggregate Aggregate operation
+template <typename T, typename Producer>
+template <typename... Aggregators, typename>
+std::tuple<AggregatorResult<Aggregators, T>...> Pipeline<T, Producer>::Aggregate(Aggregators...) const {
+    AggregatorStates<T, Aggregators...> states;
+    ForEach([&](const T& value) { states.Fold(value); return true; });
+    return states.Finish();
+}
+
+// Implementation of pipeline seeded Aggregate operation
+template <typename T, typename Producer>
+template <typename Seed, typename Func, typename>
+Seed Pipeline<T, Producer>::Aggregate(Seed seed, Func func) const {
+    ForEach([&](const T& value) { seed = func(std::move(seed), value); return true; });
+    return seed;
+}
+
+// Implementation of pipeline Stats operation
+template <typename T, typename Producer>
+RangeStats<T> Pipeline<T, Producer>::Stats() const {
+    RangeStats<T> stats;
+    ForEach([&](const T& value) {
+        if (stats.count == 0 || value < stats.min) stats.min = value;
+        if (stats.count == 0 || stats.max < value) stats.max = value;
+        stats.sum = stats.sum + value;
+        ++stats.count;
+        return true;
+    });
+    if (stats.count > 0) stats.average = static_cast<double>(stats.sum) / stats.count;
+    return stats;
+}
+
+// Implementation of pipeline Contains operation
+template <typename T, typename Producer>
+bool Pipeline<T, Producer>::Contains(const T& value) const {
+    bool found = false;
+    ForEach([&](const T& item) { found = item == value; return !found; });
+    return found;
+}
+
+// Implementation of pipeline ElementAt operation
+template <typename T, typename Producer>
+T Pipeline<T, Producer>::ElementAt(size_t index) const {
+    std::optional<T> element;
+    size_t position = 0;
+    ForEach([&](const T& value) {
+        if (position++ < index) return true;
+        element = value;
+        return false;
+    });
+    if (!element) throw std::out_of_range("Index out of range");
+    return *element;
+}
+
+// Implementation of pipeline First operation
+template <typename T, typename Producer>
+T Pipeline<T, Producer>::First() const {
+    std::optional<T> first;
+    ForEach([&](const T& value) {
+        first = value;
+        return false;
+    });
+    if (!first) throw std::logic_error("Empty range");
+    return *first;
+}
+
+// Implementation of pipeline MinBy operation
+template <typename T, typename Producer>
+template <typename KeySelector>
+T Pipeline<T, Producer>::MinBy(KeySelector keySelector) const {
+    using KeyType = std::decay_t<decltype(keySelector(std::declval<const T&>()))>;
+    std::optional<std::pair<KeyType, T>> best;
+    ForEach([&](const T& value) {
+        auto key = keySelector(value);
+        if (!best || key < best->first) best.emplace(std::move(key), value);
+        return true;
+    });
+    if (!best) throw std::logic_error("Empty range");
+    return best->second;
+}
+
+// Implementation of pipeline MaxBy operation
+template <typename T, typename Producer>
+template <typename KeySelector>
+T Pipeline<T, Producer>::MaxBy(KeySelector keySelector) const {
+    using KeyType = std::decay_t<decltype(keySelector(std::declval<const T&>()))>;
+    std::optional<std::pair<KeyType, T>> best;
+    ForEach([&](const T& value) {
+        auto key = keySelector(value);
+        if (!best || best->first < key) best.emplace(std::move(key), value);
+        return true;
+    });
+    if (!best) throw std::logic_error("Empty range");
+    return best->second;
+}
+
+// Implementation of pipeline ToSet operation
+template <typename T, typename Producer>
+std::set<T> Pipeline<T, Producer>::ToSet() const {
+    std::set<T> result;
+    ForEach([&](const T& value) { result.insert(value); return true; });
+    return result;
+}
+
+// Implementation of pipeline ToList operation
+template <typename T, typename Producer>
+std::vector<T> Pipeline<T, Producer>::ToList() const {
+    return ToVector();
+}
+
+// Implementation of pipeline ToDeque operation
+template <typename T, typename Producer>
+std::deque<T> Pipeline<T, Producer>::ToDeque() const {
+    std::deque<T> result;
+    ForEach([&](const T& value) { result.push_back(value); return true; });
+    return result;
+}
+
+// Implementation of pipeline ToVector operation
+template <typename T, typename Producer>
+std::vector<T> Pipeline<T, Producer>::ToVector() const {
+    std::vector<T> result;
+    ForEach([&](const T& value) { result.push_back(value); return true; });
+    return result;
+}
+
+// Implementation of pipeline ToRange operation
+template <typename T, typename Producer>
+MyRange<T> Pipeline<T, Producer>::ToRange() const {
+    MyRange<T> result;
+    result.source_ = ArenaShared<PipelineSource<T, Producer>>(producer_);
+    const ExecutionMode mode = producer_.Mode();
+    result.parallel_ = mode.parallel;
+    result.parallelThreshold_ = mode.parallelThreshold;
+    return result;
+}
+
+#endif // SSBESB_LAIC_PIPELINE_H
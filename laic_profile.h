@@ -0,0 +1,208 @@
+#ifndef SSBESB_LAIC_PROFILE_H
+#define SSBESB_LAIC_PROFILE_H
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <map>
+#include <memory>
+#include <memory_resource>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// Per-operator instrumentation is compiled in only when LAIC_PROFILE is defined before
+// laic.h is included; without it ExplainAnalyze reports just the plan and total run time
+#ifdef LAIC_PROFILE
+constexpr bool ProfilingEnabled = true;
+#else
+constexpr bool ProfilingEnabled = false;
+#endif
+
+// Statistics of one operator, accumulated over every run that included it. Time is inclusive
+// of the operators downstream, which receive their input from inside this one's stage
+struct OperatorProfile {
+    std::atomic<uint64_t> runs{0};
+    std::atomic<uint64_t> elementsIn{0};
+    std::atomic<uint64_t> elementsOut{0};
+    std::atomic<uint64_t> nanoseconds{0};
+    std::atomic<uint64_t> bytesAllocated{0};
+
+    void Reset() {
+        runs = 0;
+        elementsIn = 0;
+        elementsOut = 0;
+        nanoseconds = 0;
+        bytesAllocated = 0;
+    }
+};
+
+// Process-wide counts of costs that no single operator owns
+struct RangeCounters {
+    std::atomic<uint64_t> evaluations{0};
+    std::atomic<uint64_t> elementsMaterialized{0};
+    std::atomic<uint64_t> rangeCopies{0};
+    std::atomic<uint64_t> bufferCopies{0};
+    std::atomic<uint64_t> bytesCopied{0};
+};
+
+inline RangeCounters& GlobalRangeCounters() {
+    static RangeCounters counters;
+    return counters;
+}
+
+// Operator whose stage is running on this thread; allocations are charged to it
+inline OperatorProfile*& ActiveProfile() {
+    static thread_local OperatorProfile* profile = nullptr;
+    return profile;
+}
+
+// Charges the time spent in its lifetime to profile and makes profile the active one
+class ProfileScope {
+public:
+    ProfileScope(OperatorProfile& profile, bool timed)
+        : profile_(profile), previous_(ActiveProfile()), timed_(timed), start_(timed ? std::chrono::steady_clock::now() : std::chrono::steady_clock::time_point()) {
+        ActiveProfile() = &profile;
+    }
+    ~ProfileScope() {
+        ActiveProfile() = previous_;
+        if (timed_) {
+            profile_.nanoseconds += static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start_).count());
+        }
+    }
+
+    ProfileScope(const ProfileScope&) = delete;
+    ProfileScope& operator=(const ProfileScope&) = delete;
+
+private:
+    OperatorProfile& profile_;
+    OperatorProfile* previous_;
+    bool timed_;
+    std::chrono::steady_clock::time_point start_;
+};
+
+// Resource forwarding to another and charging each allocation to the active operator
+class ProfilingResource : public std::pmr::memory_resource {
+public:
+    explicit ProfilingResource(std::pmr::memory_resource* upstream) : upstream_(upstream) {}
+
+private:
+    void* do_allocate(size_t bytes, size_t alignment) override {
+        if (OperatorProfile* profile = ActiveProfile()) profile->bytesAllocated += bytes;
+        return upstream_->allocate(bytes, alignment);
+    }
+    void do_deallocate(void* pointer, size_t bytes, size_t alignment) override {
+        upstream_->deallocate(pointer, bytes, alignment);
+    }
+    bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override {
+        return this == &other;
+    }
+
+    std::pmr::memory_resource* upstream_;
+};
+
+// Profiling resource in front of upstream. It is never freed, since containers allocated
+// during a run may outlive it and return their storage through it
+inline ProfilingResource& ProfilingResourceFor(std::pmr::memory_resource* upstream) {
+    static std::mutex mutex;
+    static auto* resources = new std::map<std::pmr::memory_resource*, ProfilingResource*>();
+    std::lock_guard<std::mutex> lock(mutex);
+    ProfilingResource*& resource = (*resources)[upstream];
+    if (!resource) resource = new ProfilingResource(upstream);
+    return *resource;
+}
+
+// Member of MyRange counting its copies
+struct RangeCopyCounter {
+    RangeCopyCounter() = default;
+    RangeCopyCounter(const RangeCopyCounter&) { ++GlobalRangeCounters().rangeCopies; }
+    RangeCopyCounter& operator=(const RangeCopyCounter&) {
+        ++GlobalRangeCounters().rangeCopies;
+        return *this;
+    }
+};
+
+// Statistics of one operator in an ExplainAnalyze run, time excluding the operators after it
+struct OperatorReport {
+    std::string name;
+    uint64_t runs = 0;
+    uint64_t elementsIn = 0;
+    uint64_t elementsOut = 0;
+    uint64_t selfNanoseconds = 0;
+    uint64_t bytesAllocated = 0;
+};
+
+inline std::string JsonString(const std::string& text) {
+    std::string result = "\"";
+    for (char c : text) {
+        if (c == '"' || c == '\\') {
+            result += '\\';
+            result += c;
+        } else if (static_cast<unsigned char>(c) < 0x20) {
+            char escaped[8];
+            std::snprintf(escaped, sizeof(escaped), "\\u%04x", static_cast<unsigned>(c));
+            result += escaped;
+        } else {
+            result += c;
+        }
+    }
+    return result + "\"";
+}
+
+inline std::string RangeCountersJson() {
+    const RangeCounters& counters = GlobalRangeCounters();
+    return "{\"evaluations\":" + std::to_string(counters.evaluations.load()) +
+           ",\"elementsMaterialized\":" + std::to_string(counters.elementsMaterialized.load()) +
+           ",\"rangeCopies\":" + std::to_string(counters.rangeCopies.load()) +
+           ",\"bufferCopies\":" + std::to_string(counters.bufferCopies.load()) +
+           ",\"bytesCopied\":" + std::to_string(counters.bytesCopied.load()) + "}";
+}
+
+// Result of ExplainAnalyze: the plan run once, with per-operator statistics when profiling
+struct QueryReport {
+    std::string plan;
+    uint64_t elements = 0;
+    uint64_t nanoseconds = 0;
+    uint64_t sourceNanoseconds = 0;
+    std::vector<OperatorReport> operators;
+
+    std::string ToText() const {
+        char line[256];
+        std::string text = "Plan: " + plan + "\n";
+        std::snprintf(line, sizeof(line), "Execution: %llu elements in %.3f ms\n", static_cast<unsigned long long>(elements), nanoseconds / 1e6);
+        text += line;
+        if (!ProfilingEnabled) return text + "Per-operator statistics require building with LAIC_PROFILE\n";
+        std::snprintf(line, sizeof(line), "  %-28s %6s %12s %12s %10s %12s\n", "Operator", "Runs", "In", "Out", "Self ms", "Bytes");
+        text += line;
+        std::snprintf(line, sizeof(line), "  %-28s %6s %12s %12s %10.3f %12s\n", "Source", "", "", "", sourceNanoseconds / 1e6, "");
+        text += line;
+        for (const auto& op : operators) {
+            std::snprintf(line, sizeof(line), "  %-28s %6llu %12llu %12llu %10.3f %12llu\n", op.name.c_str(), static_cast<unsigned long long>(op.runs),
+                          static_cast<unsigned long long>(op.elementsIn), static_cast<unsigned long long>(op.elementsOut), op.selfNanoseconds / 1e6,
+                          static_cast<unsigned long long>(op.bytesAllocated));
+            text += line;
+        }
+        const RangeCounters& counters = GlobalRangeCounters();
+        std::snprintf(line, sizeof(line), "Totals: %llu evaluations, %llu range copies, %llu buffer copies (%llu bytes)\n",
+                      static_cast<unsigned long long>(counters.evaluations.load()), static_cast<unsigned long long>(counters.rangeCopies.load()),
+                      static_cast<unsigned long long>(counters.bufferCopies.load()), static_cast<unsigned long long>(counters.bytesCopied.load()));
+        return text + line;
+    }
+
+    std::string ToJson() const {
+        std::string json = "{\"plan\":" + JsonString(plan) + ",\"profiled\":" + (ProfilingEnabled ? "true" : "false") +
+                           ",\"elements\":" + std::to_string(elements) + ",\"nanoseconds\":" + std::to_string(nanoseconds) +
+                           ",\"sourceNanoseconds\":" + std::to_string(sourceNanoseconds) + ",\"operators\":[";
+        for (size_t i = 0; i < operators.size(); ++i) {
+            const auto& op = operators[i];
+            if (i > 0) json += ",";
+            json += "{\"name\":" + JsonString(op.name) + ",\"runs\":" + std::to_string(op.runs) + ",\"elementsIn\":" + std::to_string(op.elementsIn) +
+                    ",\"elementsOut\":" + std::to_string(op.elementsOut) + ",\"selfNanoseconds\":" + std::to_string(op.selfNanoseconds) +
+                    ",\"bytesAllocated\":" + std::to_string(op.bytesAllocated) + "}";
+        }
+        return json + "],\"counters\":" + RangeCountersJson() + "}";
+    }
+};
+
+#endif // SSBESB_LAIC_PROFILE_H
@@ -0,0 +1,365 @@
+#ifndef SSBESB_LAIC_SIMD_H
+#define SSBESB_LAIC_SIMD_H
+
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+#include <utility>
+
+#if (defined(__x86_64__) || defined(__i386__)) && (defined(__GNUC__) || defined(__clang__))
+#define LAIC_SIMD_X86 1
+#include <immintrin.h>
+#endif
+
+// Element types with vectorized aggregate kernels: signed 32/64-bit integers, float and double
+template <typename T>
+struct IsSimdType : std::integral_constant<bool,
+    std::is_same<T, float>::value || std::is_same<T, double>::value ||
+    (std::is_integral<T>::value && std::is_signed<T>::value && (sizeof(T) == 4 || sizeof(T) == 8))> {};
+
+// Scalar kernels, used when no vector unit is available and for the tails of the vector loops
+template <typename T>
+T ScalarSum(const T* data, size_t count) {
+    T sum = T(0);
+    for (size_t i = 0; i < count; ++i) sum = sum + data[i];
+    return sum;
+}
+
+template <typename T>
+std::pair<T, T> ScalarMinMax(const T* data, size_t count, std::pair<T, T> result) {
+    for (size_t i = 0; i < count; ++i) {
+        if (data[i] < result.first) result.first = data[i];
+        if (result.second < data[i]) result.second = data[i];
+    }
+    return result;
+}
+
+template <typename T>
+bool ScalarContains(const T* data, size_t count, const T& value) {
+    for (size_t i = 0; i < count; ++i) {
+        if (data[i] == value) return true;
+    }
+    return false;
+}
+
+// ASCII case conversion in place: letters of the other case are flipped and every other byte,
+// including those of UTF-8 sequences, is left alone, whatever the C locale
+inline void ScalarAsciiCase(char* data, size_t count, bool upper) {
+    const char first = upper ? 'a' : 'A';
+    for (size_t i = 0; i < count; ++i) {
+        if (static_cast<unsigned char>(data[i] - first) < 26) data[i] = static_cast<char>(data[i] ^ 0x20);
+    }
+}
+
+#ifdef LAIC_SIMD_X86
+
+#define LAIC_AVX2 __attribute__((target("avx2")))
+#define LAIC_SSE42 __attribute__((target("sse4.2")))
+
+// Vector operations per instruction set and element width
+template <typename T, typename = void>
+struct Avx2Ops;
+
+template <typename T>
+struct Avx2Ops<T, std::enable_if_t<std::is_integral<T>::value && sizeof(T) == 4>> {
+    using Vector = __m256i;
+    static constexpr size_t Lanes = 8;
+    LAIC_AVX2 static Vector Load(const T* data) { return _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data)); }
+    LAIC_AVX2 static void Store(T* data, Vector v) { _mm256_storeu_si256(reinterpret_cast<__m256i*>(data), v); }
+    LAIC_AVX2 static Vector Set(T value) { return _mm256_set1_epi32(static_cast<int32_t>(value)); }
+    LAIC_AVX2 static Vector Add(Vector a, Vector b) { return _mm256_add_epi32(a, b); }
+    LAIC_AVX2 static Vector Min(Vector a, Vector b) { return _mm256_min_epi32(a, b); }
+    LAIC_AVX2 static Vector Max(Vector a, Vector b) { return _mm256_max_epi32(a, b); }
+    LAIC_AVX2 static bool AnyEqual(Vector a, Vector b) { return _mm256_movemask_epi8(_mm256_cmpeq_epi32(a, b)) != 0; }
+};
+
+template <typename T>
+struct Avx2Ops<T, std::enable_if_t<std::is_integral<T>::value && sizeof(T) == 8>> {
+    using Vector = __m256i;
+    static constexpr size_t Lanes = 4;
+    LAIC_AVX2 static Vector Load(const T* data) { return _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data)); }
+    LAIC_AVX2 static void Store(T* data, Vector v) { _mm256_storeu_si256(reinterpret_cast<__m256i*>(data), v); }
+    LAIC_AVX2 static Vector Set(T value) { return _mm256_set1_epi64x(static_cast<long long>(value)); }
+    LAIC_AVX2 static Vector Add(Vector a, Vector b) { return _mm256_add_epi64(a, b); }
+    LAIC_AVX2 static Vector Min(Vector a, Vector b) { return _mm256_blendv_epi8(a, b, _mm256_cmpgt_epi64(a, b)); }
+    LAIC_AVX2 static Vector Max(Vector a, Vector b) { return _mm256_blendv_epi8(a, b, _mm256_cmpgt_epi64(b, a)); }
+    LAIC_AVX2 static bool AnyEqual(Vector a, Vector b) { return _mm256_movemask_epi8(_mm256_cmpeq_epi64(a, b)) != 0; }
+};
+
+template <>
+struct Avx2Ops<float> {
+    using Vector = __m256;
+    static constexpr size_t Lanes = 8;
+    LAIC_AVX2 static Vector Load(const float* data) { return _mm256_loadu_ps(data); }
+    LAIC_AVX2 static void Store(float* data, Vector v) { _mm256_storeu_ps(data, v); }
+    LAIC_AVX2 static Vector Set(float value) { return _mm256_set1_ps(value); }
+    LAIC_AVX2 static Vector Add(Vector a, Vector b) { return _mm256_add_ps(a, b); }
+    LAIC_AVX2 static Vector Min(Vector a, Vector b) { return _mm256_min_ps(a, b); }
+    LAIC_AVX2 static Vector Max(Vector a, Vector b) { return _mm256_max_ps(a, b); }
+    LAIC_AVX2 static bool AnyEqual(Vector a, Vector b) { return _mm256_movemask_ps(_mm256_cmp_ps(a, b, _CMP_EQ_OQ)) != 0; }
+};
+
+template <>
+struct Avx2Ops<double> {
+    using Vector = __m256d;
+    static constexpr size_t Lanes = 4;
+    LAIC_AVX2 static Vector Load(const double* data) { return _mm256_loadu_pd(data); }
+    LAIC_AVX2 static void Store(double* data, Vector v) { _mm256_storeu_pd(data, v); }
+    LAIC_AVX2 static Vector Set(double value) { return _mm256_set1_pd(value); }
+    LAIC_AVX2 static Vector Add(Vector a, Vector b) { return _mm256_add_pd(a, b); }
+    LAIC_AVX2 static Vector Min(Vector a, Vector b) { return _mm256_min_pd(a, b); }
+    LAIC_AVX2 static Vector Max(Vector a, Vector b) { return _mm256_max_pd(a, b); }
+    LAIC_AVX2 static bool AnyEqual(Vector a, Vector b) { return _mm256_movemask_pd(_mm256_cmp_pd(a, b, _CMP_EQ_OQ)) != 0; }
+};
+
+template <typename T, typename = void>
+struct Sse42Ops;
+
+template <typename T>
+struct Sse42Ops<T, std::enable_if_t<std::is_integral<T>::value && sizeof(T) == 4>> {
+    using Vector = __m128i;
+    static constexpr size_t Lanes = 4;
+    LAIC_SSE42 static Vector Load(const T* data) { return _mm_loadu_si128(reinterpret_cast<const __m128i*>(data)); }
+    LAIC_SSE42 static void Store(T* data, Vector v) { _mm_storeu_si128(reinterpret_cast<__m128i*>(data), v); }
+    LAIC_SSE42 static Vector Set(T value) { return _mm_set1_epi32(static_cast<int32_t>(value)); }
+    LAIC_SSE42 static Vector Add(Vector a, Vector b) { return _mm_add_epi32(a, b); }
+    LAIC_SSE42 static Vector Min(Vector a, Vector b) { return _mm_min_epi32(a, b); }
+    LAIC_SSE42 static Vector Max(Vector a, Vector b) { return _mm_max_epi32(a, b); }
+    LAIC_SSE42 static bool AnyEqual(Vector a, Vector b) { return _mm_movemask_epi8(_mm_cmpeq_epi32(a, b)) != 0; }
+};
+
+template <typename T>
+struct Sse42Ops<T, std::enable_if_t<std::is_integral<T>::value && sizeof(T) == 8>> {
+    using Vector = __m128i;
+    static constexpr size_t Lanes = 2;
+    LAIC_SSE42 static Vector Load(const T* data) { return _mm_loadu_si128(reinterpret_cast<const __m128i*>(data)); }
+    LAIC_SSE42 static void Store(T* data, Vector v) { _mm_storeu_si128(reinterpret_cast<__m128i*>(data), v); }
+    LAIC_SSE42 static Vector Set(T value) { return _mm_set1_epi64x(static_cast<long long>(value)); }
+    LAIC_SSE42 static Vector Add(Vector a, Vector b) { return _mm_add_epi64(a, b); }
+    LAIC_SSE42 static Vector Min(Vector a, Vector b) { return _mm_blendv_epi8(a, b, _mm_cmpgt_epi64(a, b)); }
+    LAIC_SSE42 static Vector Max(Vector a, Vector b) { return _mm_blendv_epi8(a, b, _mm_cmpgt_epi64(b, a)); }
+    LAIC_SSE42 static bool AnyEqual(Vector a, Vector b) { return _mm_movemask_epi8(_mm_cmpeq_epi64(a, b)) != 0; }
+};
+
+template <>
+struct Sse42Ops<float> {
+    using Vector = __m128;
+    static constexpr size_t Lanes = 4;
+    LAIC_SSE42 static Vector Load(const float* data) { return _mm_loadu_ps(data); }
+    LAIC_SSE42 static void Store(float* data, Vector v) { _mm_storeu_ps(data, v); }
+    LAIC_SSE42 static Vector Set(float value) { return _mm_set1_ps(value); }
+    LAIC_SSE42 static Vector Add(Vector a, Vector b) { return _mm_add_ps(a, b); }
+    LAIC_SSE42 static Vector Min(Vector a, Vector b) { return _mm_min_ps(a, b); }
+    LAIC_SSE42 static Vector Max(Vector a, Vector b) { return _mm_max_ps(a, b); }
+    LAIC_SSE42 static bool AnyEqual(Vector a, Vector b) { return _mm_movemask_ps(_mm_cmpeq_ps(a, b)) != 0; }
+};
+
+template <>
+struct Sse42Ops<double> {
+    using Vector = __m128d;
+    static constexpr size_t Lanes = 2;
+    LAIC_SSE42 static Vector Load(const double* data) { return _mm_loadu_pd(data); }
+    LAIC_SSE42 static void Store(double* data, Vector v) { _mm_storeu_pd(data, v); }
+    LAIC_SSE42 static Vector Set(double value) { return _mm_set1_pd(value); }
+    LAIC_SSE42 static Vector Add(Vector a, Vector b) { return _mm_add_pd(a, b); }
+    LAIC_SSE42 static Vector Min(Vector a, Vector b) { return _mm_min_pd(a, b); }
+    LAIC_SSE42 static Vector Max(Vector a, Vector b) { return _mm_max_pd(a, b); }
+    LAIC_SSE42 static bool AnyEqual(Vector a, Vector b) { return _mm_movemask_pd(_mm_cmpeq_pd(a, b)) != 0; }
+};
+
+// Kernels are written once per instruction set, since the target attribute must be on
+// the function that the vector operations inline into
+template <typename T>
+LAIC_AVX2 T Avx2Sum(const T* data, size_t count) {
+    using Ops = Avx2Ops<T>;
+    constexpr size_t step = Ops::Lanes * 4;
+    if (count < step) return ScalarSum(data, count);
+    auto sum0 = Ops::Set(T(0)), sum1 = sum0, sum2 = sum0, sum3 = sum0;
+    size_t i = 0;
+    for (; i + step <= count; i += step) {
+        sum0 = Ops::Add(sum0, Ops::Load(data + i));
+        sum1 = Ops::Add(sum1, Ops::Load(data + i + Ops::Lanes));
+        sum2 = Ops::Add(sum2, Ops::Load(data + i + Ops::Lanes * 2));
+        sum3 = Ops::Add(sum3, Ops::Load(data + i + Ops::Lanes * 3));
+    }
+    T lanes[Ops::Lanes];
+    Ops::Store(lanes, Ops::Add(Ops::Add(sum0, sum1), Ops::Add(sum2, sum3)));
+    return ScalarSum(lanes, Ops::Lanes) + ScalarSum(data + i, count - i);
+}
+
+template <typename T>
+LAIC_AVX2 std::pair<T, T> Avx2MinMax(const T* data, size_t count) {
+    using Ops = Avx2Ops<T>;
+    if (count < Ops::Lanes) return ScalarMinMax(data + 1, count - 1, std::make_pair(data[0], data[0]));
+    auto min = Ops::Load(data), max = min;
+    size_t i = Ops::Lanes;
+    for (; i + Ops::Lanes <= count; i += Ops::Lanes) {
+        auto v = Ops::Load(data + i);
+        min = Ops::Min(min, v);
+        max = Ops::Max(max, v);
+    }
+    T mins[Ops::Lanes], maxes[Ops::Lanes];
+    Ops::Store(mins, min);
+    Ops::Store(maxes, max);
+    auto result = std::make_pair(mins[0], maxes[0]);
+    for (size_t lane = 1; lane < Ops::Lanes; ++lane) {
+        if (mins[lane] < result.first) result.first = mins[lane];
+        if (result.second < maxes[lane]) result.second = maxes[lane];
+    }
+    return ScalarMinMax(data + i, count - i, result);
+}
+
+template <typename T>
+LAIC_AVX2 bool Avx2Contains(const T* data, size_t count, T value) {
+    using Ops = Avx2Ops<T>;
+    auto needle = Ops::Set(value);
+    size_t i = 0;
+    for (; i + Ops::Lanes <= count; i += Ops::Lanes) {
+        if (Ops::AnyEqual(Ops::Load(data + i), needle)) return true;
+    }
+    return ScalarContains(data + i, count - i, value);
+}
+
+template <typename T>
+LAIC_SSE42 T Sse42Sum(const T* data, size_t count) {
+    using Ops = Sse42Ops<T>;
+    constexpr size_t step = Ops::Lanes * 4;
+    if (count < step) return ScalarSum(data, count);
+    auto sum0 = Ops::Set(T(0)), sum1 = sum0, sum2 = sum0, sum3 = sum0;
+    size_t i = 0;
+    for (; i + step <= count; i += step) {
+        sum0 = Ops::Add(sum0, Ops::Load(data + i));
+        sum1 = Ops::Add(sum1, Ops::Load(data + i + Ops::Lanes));
+        sum2 = Ops::Add(sum2, Ops::Load(data + i + Ops::Lanes * 2));
+        sum3 = Ops::Add(sum3, Ops::Load(data + i + Ops::Lanes * 3));
+    }
+    T lanes[Ops::Lanes];
+    Ops::Store(lanes, Ops::Add(Ops::Add(sum0, sum1), Ops::Add(sum2, sum3)));
+    return ScalarSum(lanes, Ops::Lanes) + ScalarSum(data + i, count - i);
+}
+
+template <typename T>
+LAIC_SSE42 std::pair<T, T> Sse42MinMax(const T* data, size_t count) {
+    using Ops = Sse42Ops<T>;
+    if (count < Ops::Lanes) return ScalarMinMax(data + 1, count - 1, std::make_pair(data[0], data[0]));
+    auto min = Ops::Load(data), max = min;
+    size_t i = Ops::Lanes;
+    for (; i + Ops::Lanes <= count; i += Ops::Lanes) {
+        auto v = Ops::Load(data + i);
+        min = Ops::Min(min, v);
+        max = Ops::Max(max, v);
+    }
+    T mins[Ops::Lanes], maxes[Ops::Lanes];
+    Ops::Store(mins, min);
+    Ops::Store(maxes, max);
+    auto result = std::make_pair(mins[0], maxes[0]);
+    for (size_t lane = 1; lane < Ops::Lanes; ++lane) {
+        if (mins[lane] < result.first) result.first = mins[lane];
+        if (result.second < maxes[lane]) result.second = maxes[lane];
+    }
+    return ScalarMinMax(data + i, count - i, result);
+}
+
+template <typename T>
+LAIC_SSE42 bool Sse42Contains(const T* data, size_t count, T value) {
+    using Ops = Sse42Ops<T>;
+    auto needle = Ops::Set(value);
+    size_t i = 0;
+    for (; i + Ops::Lanes <= count; i += Ops::Lanes) {
+        if (Ops::AnyEqual(Ops::Load(data + i), needle)) return true;
+    }
+    return ScalarContains(data + i, count - i, value);
+}
+
+// Bytes are compared as signed, so those of 0x80 and above are never taken for letters
+LAIC_AVX2 inline void Avx2AsciiCase(char* data, size_t count, bool upper) {
+    const __m256i before = _mm256_set1_epi8(static_cast<char>((upper ? 'a' : 'A') - 1));
+    const __m256i after = _mm256_set1_epi8(static_cast<char>((upper ? 'z' : 'Z') + 1));
+    const __m256i flip = _mm256_set1_epi8(0x20);
+    size_t i = 0;
+    for (; i + 32 <= count; i += 32) {
+        __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + i));
+        __m256i letters = _mm256_and_si256(_mm256_cmpgt_epi8(v, before), _mm256_cmpgt_epi8(after, v));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(data + i), _mm256_xor_si256(v, _mm256_and_si256(letters, flip)));
+    }
+    ScalarAsciiCase(data + i, count - i, upper);
+}
+
+LAIC_SSE42 inline void Sse42AsciiCase(char* data, size_t count, bool upper) {
+    const __m128i before = _mm_set1_epi8(static_cast<char>((upper ? 'a' : 'A') - 1));
+    const __m128i after = _mm_set1_epi8(static_cast<char>((upper ? 'z' : 'Z') + 1));
+    const __m128i flip = _mm_set1_epi8(0x20);
+    size_t i = 0;
+    for (; i + 16 <= count; i += 16) {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i));
+        __m128i letters = _mm_and_si128(_mm_cmpgt_epi8(v, before), _mm_cmpgt_epi8(after, v));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(data + i), _mm_xor_si128(v, _mm_and_si128(letters, flip)));
+    }
+    ScalarAsciiCase(data + i, count - i, upper);
+}
+
+// Instruction set supported by the running CPU, detected once
+enum class SimdLevel { Scalar, Sse42, Avx2 };
+
+inline SimdLevel DetectSimdLevel() {
+    static const SimdLevel level = [] {
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx2")) return SimdLevel::Avx2;
+        if (__builtin_cpu_supports("sse4.2")) return SimdLevel::Sse42;
+        return SimdLevel::Scalar;
+    }();
+    return level;
+}
+
+#endif // LAIC_SIMD_X86
+
+// Dispatching entry points; only valid for IsSimdType element types
+template <typename T>
+T SimdSum(const T* data, size_t count) {
+#ifdef LAIC_SIMD_X86
+    switch (DetectSimdLevel()) {
+        case SimdLevel::Avx2: return Avx2Sum(data, count);
+        case SimdLevel::Sse42: return Sse42Sum(data, count);
+        default: break;
+    }
+#endif
+    return ScalarSum(data, count);
+}
+
+// Requires count > 0
+template <typename T>
+std::pair<T, T> SimdMinMax(const T* data, size_t count) {
+#ifdef LAIC_SIMD_X86
+    switch (DetectSimdLevel()) {
+        case SimdLevel::Avx2: return Avx2MinMax(data, count);
+        case SimdLevel::Sse42: return Sse42MinMax(data, count);
+        default: break;
+    }
+#endif
+    return ScalarMinMax(data + 1, count - 1, std::make_pair(data[0], data[0]));
+}
+
+template <typename T>
+bool SimdContains(const T* data, size_t count, T value) {
+#ifdef LAIC_SIMD_X86
+    switch (DetectSimdLevel()) {
+        case SimdLevel::Avx2: return Avx2Contains(data, count, value);
+        case SimdLevel::Sse42: return Sse42Contains(data, count, value);
+        default: break;
+    }
+#endif
+    return ScalarContains(data, count, value);
+}
+
+inline void SimdAsciiCase(char* data, size_t count, bool upper) {
+#ifdef LAIC_SIMD_X86
+    switch (DetectSimdLevel()) {
+        case SimdLevel::Avx2: Avx2AsciiCase(data, count, upper); return;
+        case SimdLevel::Sse42: Sse42AsciiCase(data, count, upper); return;
+        default: break;
+    }
+#endif
+    ScalarAsciiCase(data, count, upper);
+}
+
+#endif // SSBESB_LAIC_SIMD_H
@@ -0,0 +1,91 @@
+#ifndef SSBESB_LAIC_SORT_H
+#define SSBESB_LAIC_SORT_H
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+// Order-preserving mapping of integer and floating-point keys onto unsigned integers
+template <typename Key, typename = void>
+struct RadixTraits {
+    static constexpr bool Supported = false;
+};
+
+template <typename Key>
+struct RadixTraits<Key, std::enable_if_t<std::is_integral<Key>::value && !std::is_same<Key, bool>::value>> {
+    static constexpr bool Supported = true;
+    using Bits = std::make_unsigned_t<Key>;
+    static Bits Encode(Key key) {
+        if (std::is_signed<Key>::value) return static_cast<Bits>(key) ^ static_cast<Bits>(Bits(1) << (sizeof(Bits) * 8 - 1));
+        return static_cast<Bits>(key);
+    }
+};
+
+template <typename Key>
+struct RadixTraits<Key, std::enable_if_t<std::is_floating_point<Key>::value && (sizeof(Key) == 4 || sizeof(Key) == 8)>> {
+    static constexpr bool Supported = true;
+    using Bits = std::conditional_t<sizeof(Key) == 4, uint32_t, uint64_t>;
+    static Bits Encode(Key key) {
+        if (key == Key(0)) key = Key(0);  // -0.0 sorts equal to 0.0
+        Bits bits;
+        std::memcpy(&bits, &key, sizeof(bits));
+        const Bits sign = Bits(1) << (sizeof(Bits) * 8 - 1);
+        return (bits & sign) ? static_cast<Bits>(~bits) : static_cast<Bits>(bits | sign);
+    }
+};
+
+// Inputs below this size are sorted by comparison even when the key supports radix sort
+constexpr size_t RadixSortThreshold = 512;
+
+// Stable LSD radix sort of (key, payload) pairs on 8-bit digits; passes where every
+// element shares the digit are skipped
+template <typename Items>
+void RadixSortPairs(Items& items, bool descending) {
+    using Key = typename Items::value_type::first_type;
+    using Traits = RadixTraits<Key>;
+    using Bits = typename Traits::Bits;
+    Items buffer(items.size(), items.get_allocator());
+    auto* from = &items;
+    auto* to = &buffer;
+    auto digit = [descending](const Key& key, unsigned shift) {
+        Bits bits = Traits::Encode(key);
+        if (descending) bits = static_cast<Bits>(~bits);
+        return static_cast<size_t>((bits >> shift) & 0xFF);
+    };
+    for (unsigned shift = 0; shift < sizeof(Bits) * 8; shift += 8) {
+        size_t offsets[256] = {};
+        for (const auto& item : *from) ++offsets[digit(item.first, shift)];
+        if (std::find(std::begin(offsets), std::end(offsets), from->size()) != std::end(offsets)) continue;
+        size_t total = 0;
+        for (auto& offset : offsets) {
+            const size_t count = offset;
+            offset = total;
+            total += count;
+        }
+        for (auto& item : *from) (*to)[offsets[digit(item.first, shift)]++] = std::move(item);
+        std::swap(from, to);
+    }
+    if (from != &items) items.swap(buffer);
+}
+
+// Stable sort of a vector of (key, payload) pairs by key, radix sorting arithmetic keys
+template <typename Items>
+void StableSortPairs(Items& items, bool descending) {
+    if constexpr (RadixTraits<typename Items::value_type::first_type>::Supported) {
+        if (items.size() >= RadixSortThreshold) {
+            RadixSortPairs(items, descending);
+            return;
+        }
+    }
+    if (descending) {
+        std::stable_sort(items.begin(), items.end(), [](const auto& a, const auto& b) { return b.first < a.first; });
+    } else {
+        std::stable_sort(items.begin(), items.end(), [](const auto& a, const auto& b) { return a.first < b.first; });
+    }
+}
+
+#endif // SSBESB_LAIC_SORT_H
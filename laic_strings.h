@@ -0,0 +1,238 @@
+#ifndef SSBESB_LAIC_STRINGS_H
+#define SSBESB_LAIC_STRINGS_H
+
+#include "laic.h"
+#include <string_view>
+
+// Characters of many strings back to back in one buffer: string i is chars[offsets[i], offsets[i + 1])
+struct StringArena {
+    std::vector<char> chars;
+    std::vector<size_t> offsets{0};
+
+    size_t Size() const { return offsets.size() - 1; }
+    std::string_view operator[](size_t i) const {
+        return std::string_view(chars.data() + offsets[i], offsets[i + 1] - offsets[i]);
+    }
+    void Append(std::string_view value) {
+        chars.insert(chars.end(), value.begin(), value.end());
+        offsets.push_back(chars.size());
+    }
+};
+
+// Source yielding views into a StringArena it keeps alive
+class StringArenaSource : public RangeSource<std::string_view> {
+public:
+    StringArenaSource(std::shared_ptr<const StringArena> arena) : arena_(std::move(arena)) {}
+    void Produce(Sink<std::string_view>& sink) const override { ProduceSlice(sink, 0, Size()); }
+    bool IsPartitionable() const override { return true; }
+    size_t Size() const override { return arena_->Size(); }
+    std::optional<size_t> Count() const override { return Size(); }
+    std::shared_ptr<const void> Pin() const override { return arena_; }
+    std::string Describe(bool) const override { return "Strings(" + std::to_string(Size()) + ")"; }
+    void ProduceSlice(Sink<std::string_view>& sink, size_t first, size_t last) const override {
+        ArenaVector<std::string_view> batch;
+        last = std::min(last, Size());
+        for (size_t offset = first; offset < last; offset += BatchSize) {
+            const size_t size = std::min(BatchSize, last - offset);
+            FillBatch(batch, size, [&](size_t i) { return (*arena_)[offset + i]; });
+            if (!sink.PushBatch(batch.data(), size)) return;
+        }
+    }
+private:
+    std::shared_ptr<const StringArena> arena_;
+};
+
+// Immutable sequence of strings kept in a single StringArena instead of one heap block per
+// string. Elements are read as std::string_view; case conversion runs the SIMD kernels over
+// the whole buffer at once, and a temporary whose arena is not shared converts in place
+class StringRange {
+public:
+    StringRange() : arena_(std::make_shared<StringArena>()) {}
+
+    explicit StringRange(const std::vector<std::string>& strings);
+    explicit StringRange(const std::vector<std::string_view>& strings);
+
+    // Constructor that streams a MyRange<std::string> or MyRange<std::string_view>
+    template <typename T>
+    explicit StringRange(const MyRange<T>& range);
+
+    // Operations producing a new arena, each sized once up front
+    // ASCII letters only; every other byte, including UTF-8 sequences, is left as it is
+    StringRange ToUpperCase() const&;
+    StringRange ToUpperCase() &&;
+    StringRange ToLowerCase() const&;
+    StringRange ToLowerCase() &&;
+    StringRange AddPrefix(std::string_view prefix) const;
+    StringRange AddSuffix(std::string_view suffix) const;
+
+    // Keeps the strings for which predicate, called with a std::string_view, holds
+    template <typename Predicate>
+    StringRange Where(Predicate predicate) const;
+
+    // Immediate operations
+    size_t Count() const { return arena_->Size(); }
+    bool Contains(std::string_view value) const;
+    std::string_view ElementAt(size_t index) const;
+    std::string_view operator[](size_t index) const { return (*arena_)[index]; }
+
+    // Lazy MyRange of views into the arena, which it keeps alive
+    MyRange<std::string_view> Views() const;
+
+    // Copies out as owning strings
+    std::vector<std::string> ToVector() const;
+    MyRange<std::string> ToRange() const;
+
+    const StringArena& Arena() const { return *arena_; }
+
+private:
+    explicit StringRange(std::shared_ptr<StringArena> arena) : arena_(std::move(arena)) {}
+
+    // Arena holding these strings with the case of their ASCII letters changed
+    std::shared_ptr<StringArena> ConvertCase(bool upper) const;
+
+    // Shared between copies; an rvalue that holds the only reference may modify it
+    std::shared_ptr<StringArena> arena_;
+};
+
+// Implementation of StringRange constructors
+inline StringRange::StringRange(const std::vector<std::string>& strings) : arena_(std::make_shared<StringArena>()) {
+    size_t total = 0;
+    for (const auto& value : strings) total += value.size();
+    arena_->chars.reserve(total);
+    arena_->offsets.reserve(strings.size() + 1);
+    for (const auto& value : strings) arena_->Append(value);
+}
+
+inline StringRange::StringRange(const std::vector<std::string_view>& strings) : arena_(std::make_shared<StringArena>()) {
+    size_t total = 0;
+    for (auto value : strings) total += value.size();
+    arena_->chars.reserve(total);
+    arena_->offsets.reserve(strings.size() + 1);
+    for (auto value : strings) arena_->Append(value);
+}
+
+template <typename T>
+StringRange::StringRange(const MyRange<T>& range) : arena_(std::make_shared<StringArena>()) {
+    static_assert(std::is_convertible<const T&, std::string_view>::value, "StringRange holds std::string or std::string_view elements");
+    if (range.IsBuffered()) arena_->offsets.reserve(range.Data().size() + 1);
+    range.ForEach([this](const T& value) {
+        arena_->Append(value);
+        return true;
+    });
+}
+
+// Implementation of StringRange case conversion
+inline std::shared_ptr<StringArena> StringRange::ConvertCase(bool upper) const {
+    auto result = std::make_shared<StringArena>(*arena_);
+    SimdAsciiCase(result->chars.data(), result->chars.size(), upper);
+    return result;
+}
+
+// Implementation of StringRange ToUpperCase operation
+inline StringRange StringRange::ToUpperCase() const& {
+    return StringRange(ConvertCase(true));
+}
+
+inline StringRange StringRange::ToUpperCase() && {
+    if (arena_.use_count() != 1) return StringRange(ConvertCase(true));
+    SimdAsciiCase(arena_->chars.data(), arena_->chars.size(), true);
+    return std::move(*this);
+}
+
+// Implementation of StringRange ToLowerCase operation
+inline StringRange StringRange::ToLowerCase() const& {
+    return StringRange(ConvertCase(false));
+}
+
+inline StringRange StringRange::ToLowerCase() && {
+    if (arena_.use_count() != 1) return StringRange(ConvertCase(false));
+    SimdAsciiCase(arena_->chars.data(), arena_->chars.size(), false);
+    return std::move(*this);
+}
+
+// Implementation of StringRange AddPrefix operation
+inline StringRange StringRange::AddPrefix(std::string_view prefix) const {
+    const size_t count = Count();
+    auto result = std::make_shared<StringArena>();
+    result->chars.resize(arena_->chars.size() + count * prefix.size());
+    result->offsets.resize(count + 1);
+    char* out = result->chars.data();
+    for (size_t i = 0; i < count; ++i) {
+        const std::string_view value = (*arena_)[i];
+        out = std::copy(value.begin(), value.end(), std::copy(prefix.begin(), prefix.end(), out));
+        result->offsets[i + 1] = out - result->chars.data();
+    }
+    return StringRange(std::move(result));
+}
+
+// Implementation of StringRange AddSuffix operation
+inline StringRange StringRange::AddSuffix(std::string_view suffix) const {
+    const size_t count = Count();
+    auto result = std::make_shared<StringArena>();
+    result->chars.resize(arena_->chars.size() + count * suffix.size());
+    result->offsets.resize(count + 1);
+    char* out = result->chars.data();
+    for (size_t i = 0; i < count; ++i) {
+        const std::string_view value = (*arena_)[i];
+        out = std::copy(suffix.begin(), suffix.end(), std::copy(value.begin(), value.end(), out));
+        result->offsets[i + 1] = out - result->chars.data();
+    }
+    return StringRange(std::move(result));
+}
+
+// Implementation of StringRange Where operation
+template <typename Predicate>
+StringRange StringRange::Where(Predicate predicate) const {
+    auto result = std::make_shared<StringArena>();
+    // The kept strings never need more room than all of them
+    result->chars.reserve(arena_->chars.size());
+    result->offsets.reserve(Count() + 1);
+    for (size_t i = 0; i < Count(); ++i) {
+        const std::string_view value = (*arena_)[i];
+        if (predicate(value)) result->Append(value);
+    }
+    return StringRange(std::move(result));
+}
+
+// Implementation of StringRange Contains operation
+inline bool StringRange::Contains(std::string_view value) const {
+    // Lengths come from the offsets, so most strings are rejected without touching their characters
+    for (size_t i = 0; i < Count(); ++i) {
+        if ((*arena_)[i] == value) return true;
+    }
+    return false;
+}
+
+// Implementation of StringRange ElementAt operation
+inline std::string_view StringRange::ElementAt(size_t index) const {
+    if (index >= Count()) throw std::out_of_range("Index out of range");
+    return (*arena_)[index];
+}
+
+// Implementation of StringRange Views operation
+inline MyRange<std::string_view> StringRange::Views() const {
+    MyRange<std::string_view> result;
+    result.source_ = ArenaShared<StringArenaSource>(arena_);
+    return result;
+}
+
+// Implementation of StringRange ToVector operation
+inline std::vector<std::string> StringRange::ToVector() const {
+    std::vector<std::string> result;
+    result.reserve(Count());
+    for (size_t i = 0; i < Count(); ++i) result.emplace_back((*arena_)[i]);
+    return result;
+}
+
+// Implementation of StringRange ToRange operation
+inline MyRange<std::string> StringRange::ToRange() const {
+    return MyRange<std::string>(ToVector());
+}
+
+// Implementation of ToStringRange
+template <typename T>
+StringRange MyRange<T>::ToStringRange() const {
+    return StringRange(*this);
+}
+
+#endif // SSBESB_LAIC_STRINGS_H
@@ -0,0 +1,547 @@
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <deque>
+#include <fstream>
+#include <list>
+#include <map>
+#include <set>
+#include <string>
+#include <string_view>
+#include <unistd.h>
+#include <vector>
+#include "laic.h"
+#include "preprocessor.h"
+
+// Unit tests of MyRange. Each TEST registers itself; a failing CHECK reports its location and
+// fails the run. With an argument only the tests whose name contains it are run
+
+struct TestCase {
+    const char* name;
+    void (*run)();
+};
+
+std::vector<TestCase>& Tests() {
+    static std::vector<TestCase> tests;
+    return tests;
+}
+
+static int failures = 0;
+
+#define TEST(name)                                                                 \
+    static void name();                                                            \
+    static const bool name##Registered = (Tests().push_back({#name, name}), true); \
+    static void name()
+
+#define CHECK(condition)                                                                  \
+    do {                                                                                  \
+        if (!(condition)) {                                                               \
+            std::fprintf(stderr, "%s:%d: CHECK failed: %s\n", __FILE__, __LINE__, #condition); \
+            ++failures;                                                                   \
+        }                                                                                 \
+    } while (0)
+
+// Temporary file holding the given lines, removed with the object
+class TempLines {
+public:
+    explicit TempLines(const std::vector<std::string>& lines) {
+        char name[] = "/tmp/laic_testsXXXXXX";
+        const int fd = mkstemp(name);
+        if (fd < 0) std::abort();
+        close(fd);
+        path_ = name;
+        std::ofstream out(path_);
+        for (const auto& line : lines) out << line << "\n";
+    }
+    ~TempLines() { std::remove(path_.c_str()); }
+    const std::string& Path() const { return path_; }
+private:
+    std::string path_;
+};
+
+std::vector<std::string> Strings(const std::vector<std::string_view>& views) {
+    return std::vector<std::string>(views.begin(), views.end());
+}
+
+const std::vector<std::string> Words = {"apple", "kiwi", "banana", "fig", "cherry", "kiwi"};
+
+// Views yielded from a mapped file stay valid after evaluation, whatever the shape of the query;
+// the mapping is only reachable through the evaluated range, so a lost pin reads unmapped memory
+
+TEST(PinsThroughIntersect) {
+    TempLines file(Words);
+    auto range = MyRange<std::string_view>::FromLines(file.Path())
+                     .Where([](std::string_view s) { return s.size() > 3; })
+                     .Intersect(MyRange<std::string_view>::FromLines(file.Path()));
+    CHECK(range.Count() == 4);
+    CHECK(Strings(range.ToVector()) == std::vector<std::string>({"apple", "kiwi", "banana", "cherry"}));
+}
+
+TEST(PinsThroughExcept) {
+    TempLines file(Words);
+    auto range = MyRange<std::string_view>::FromLines(file.Path()).Except(MyRange<std::string_view>(std::vector<std::string_view>{"kiwi"}));
+    CHECK(range.Count() == 4);
+    CHECK(Strings(range.ToVector()) == std::vector<std::string>({"apple", "banana", "fig", "cherry"}));
+}
+
+TEST(PinsThroughConcat) {
+    TempLines first({"a", "b"});
+    TempLines second({"c", "d"});
+    auto range = MyRange<std::string_view>::FromLines(first.Path()).Concat(MyRange<std::string_view>::FromLines(second.Path()));
+    CHECK(range.Count() == 4);
+    CHECK(Strings(range.ToVector()) == std::vector<std::string>({"a", "b", "c", "d"}));
+}
+
+TEST(PinsThroughGroupBy) {
+    TempLines file(Words);
+    MyRange<std::pair<size_t, std::vector<std::string_view>>> groups =
+        MyRange<std::string_view>::FromLines(file.Path()).GroupBy([](std::string_view s) { return s.size(); }).ToRange();
+    CHECK(groups.Count() == 4);
+    auto all = groups.ToVector();
+    CHECK(all.size() == 4);
+    for (const auto& group : groups) {
+        if (group.first == 6) CHECK(Strings(group.second) == std::vector<std::string>({"banana", "cherry"}));
+    }
+}
+
+TEST(PinsThroughJoin) {
+    TempLines file(Words);
+    auto lengths = MyRange<int>(std::vector<int>{4, 6});
+    auto range = MyRange<std::string_view>::FromLines(file.Path())
+                     .Join(lengths, [](std::string_view s) { return static_cast<int>(s.size()); }, [](int n) { return n; },
+                           [](std::string_view s, int) { return s; });
+    CHECK(range.Count() == 4);
+    CHECK(Strings(range.ToVector()) == std::vector<std::string>({"kiwi", "banana", "cherry", "kiwi"}));
+}
+
+TEST(PinsThroughSelect) {
+    TempLines file(Words);
+    auto range = MyRange<std::string_view>::FromLines(file.Path()).Select([](std::string_view s) { return std::make_pair(s, s.size()); });
+    CHECK(range.Count() == 6);
+    auto pairs = range.ToVector();
+    CHECK(pairs.size() == 6 && pairs[2].first == "banana" && pairs[2].second == 6);
+}
+
+TEST(PinsThroughPipeline) {
+    TempLines file(Words);
+    MyRange<std::string_view> range = MyRange<std::string_view>::FromLines(file.Path()).AsPipeline().Where([](std::string_view s) { return s[0] == 'k'; }).ToRange();
+    CHECK(range.Count() == 2);
+    CHECK(Strings(range.ToVector()) == std::vector<std::string>({"kiwi", "kiwi"}));
+}
+
+TEST(PinsThroughMemoize) {
+    TempLines file(Words);
+    auto range = MyRange<std::string_view>::FromLines(file.Path()).Memoize().Skip(4);
+    CHECK(range.Count() == 2);
+    CHECK(Strings(range.ToVector()) == std::vector<std::string>({"cherry", "kiwi"}));
+}
+
+// Rewrites applied as operations are added, each checked against the same steps done with
+// standard algorithms on a vector, and against the plan Explain reports
+
+std::vector<int> Numbers() {
+    std::vector<int> values;
+    uint32_t state = 12345;
+    for (int i = 0; i < 300; ++i) {
+        state = state * 1103515245u + 12345u;
+        values.push_back(static_cast<int>((state >> 16) % 60));
+    }
+    return values;
+}
+
+std::vector<int> Sequence(int count) {
+    std::vector<int> values(static_cast<size_t>(count));
+    for (int i = 0; i < count; ++i) values[static_cast<size_t>(i)] = i % 1000;
+    return values;
+}
+
+std::vector<int> DistinctOf(const std::vector<int>& values) {
+    std::vector<int> result;
+    std::set<int> seen;
+    for (int value : values) {
+        if (seen.insert(value).second) result.push_back(value);
+    }
+    return result;
+}
+
+std::vector<int> Filtered(const std::vector<int>& values, bool (*predicate)(int)) {
+    std::vector<int> result;
+    std::copy_if(values.begin(), values.end(), std::back_inserter(result), predicate);
+    return result;
+}
+
+std::vector<int> Sorted(std::vector<int> values) {
+    std::stable_sort(values.begin(), values.end());
+    return values;
+}
+
+std::vector<int> Slice(const std::vector<int>& values, size_t skip, size_t take) {
+    skip = std::min(skip, values.size());
+    return std::vector<int>(values.begin() + skip, values.begin() + std::min(values.size(), skip + std::min(take, values.size())));
+}
+
+bool IsEven(int x) { return x % 2 == 0; }
+bool IsSmall(int x) { return x < 20; }
+
+std::string Optimized(const std::string& explain) {
+    return explain.substr(explain.find("Optimized: ") + 11);
+}
+
+TEST(RewriteFusesAdjacentWheres) {
+    auto range = MyRange<int>(Numbers()).Where(IsEven).Where(IsSmall);
+    CHECK(Optimized(range.Explain()).find("Where(2 predicates)") != std::string::npos);
+    CHECK(range.ToVector() == Filtered(Filtered(Numbers(), IsEven), IsSmall));
+}
+
+TEST(RewriteMovesWhereAheadOfFullSort) {
+    auto range = MyRange<int>(Numbers()).OrderBy([](int x) { return x; }).Where(IsEven);
+    CHECK(Optimized(range.Explain()).find("Where -> OrderBy") != std::string::npos);
+    CHECK(range.ToVector() == Filtered(Sorted(Numbers()), IsEven));
+}
+
+TEST(RewriteKeepsWhereAfterTopK) {
+    auto range = MyRange<int>(Numbers()).OrderBy([](int x) { return x; }).Take(10).Where(IsEven);
+    CHECK(Optimized(range.Explain()).find("top 10) -> Where") != std::string::npos);
+    CHECK(range.ToVector() == Filtered(Slice(Sorted(Numbers()), 0, 10), IsEven));
+}
+
+TEST(RewriteMovesWhereAheadOfDistinct) {
+    auto ints = MyRange<int>(Numbers()).Distinct().Where(IsEven);
+    CHECK(Optimized(ints.Explain()).find("Where -> Distinct") != std::string::npos);
+    CHECK(ints.ToVector() == Filtered(DistinctOf(Numbers()), IsEven));
+    auto strings = MyRange<std::string>(std::vector<std::string>{"b", "a", "b", "c", "a"}).Distinct().Where([](const std::string& s) { return s != "c"; });
+    CHECK(Optimized(strings.Explain()).find("Where -> Distinct") != std::string::npos);
+    CHECK(strings.ToVector() == std::vector<std::string>({"b", "a"}));
+}
+
+struct Person {
+    int id;
+    std::string name;
+    bool operator==(const Person& other) const { return id == other.id; }
+    bool operator<(const Person& other) const { return id < other.id; }
+};
+
+TEST(RewriteKeepsWhereAfterDistinctOnPartialEquality) {
+    auto range = MyRange<Person>(std::vector<Person>{{1, "ann"}, {1, "bob"}}).Distinct().Where([](const Person& p) { return p.name == "bob"; });
+    CHECK(Optimized(range.Explain()).find("Distinct -> Where") != std::string::npos);
+    CHECK(range.Count() == 0);
+    CHECK(range.ToVector().empty());
+}
+
+TEST(RewriteKeepsWhereAfterDistinctOnSignedZeros) {
+    auto range = MyRange<double>(std::vector<double>{-0.0, 0.0}).Distinct().Where([](double x) { return !std::signbit(x); });
+    CHECK(range.Count() == 0);
+    CHECK(range.ToVector().empty());
+}
+
+TEST(RewriteFoldsSkipsAndTakes) {
+    auto range = MyRange<int>(Numbers()).Skip(5).Skip(7).Take(40).Take(25);
+    CHECK(Optimized(range.Explain()).find("Skip(12) -> Take(25)") != std::string::npos);
+    CHECK(range.ToVector() == Slice(Numbers(), 12, 25));
+    CHECK(MyRange<int>(Numbers()).Skip(SIZE_MAX).Skip(1).ToVector().empty());
+}
+
+TEST(RewriteTurnsOrderByTakeIntoTopK) {
+    auto range = MyRange<int>(Numbers()).OrderByDescending([](int x) { return x; }).Take(20).Take(30);
+    CHECK(Optimized(range.Explain()).find("top 20") != std::string::npos);
+    auto expected = Sorted(Numbers());
+    std::reverse(expected.begin(), expected.end());
+    CHECK(range.ToVector() == Slice(expected, 0, 20));
+    auto pairs = MyRange<int>(Numbers()).OrderBy([](int x) { return x % 7; }).ThenBy([](int x) { return x; }).Take(15).ToVector();
+    auto reference = Numbers();
+    std::stable_sort(reference.begin(), reference.end(), [](int a, int b) { return std::make_pair(a % 7, a) < std::make_pair(b % 7, b); });
+    CHECK(pairs == Slice(reference, 0, 15));
+}
+
+TEST(RewriteCancelsAndFoldsReverses) {
+    auto cancelled = MyRange<int>(Numbers()).Reverse().Reverse();
+    CHECK(Optimized(cancelled.Explain()) == "Buffer(300 elements)\n");
+    CHECK(cancelled.ToVector() == Numbers());
+    auto tail = MyRange<int>(Numbers()).Reverse().Take(30).Take(12);
+    CHECK(Optimized(tail.Explain()).find("ReverseTake(12)") != std::string::npos);
+    auto reversed = Numbers();
+    std::reverse(reversed.begin(), reversed.end());
+    CHECK(tail.ToVector() == Slice(reversed, 0, 12));
+}
+
+TEST(ReverseTakeReadsOnlyTheTail) {
+    const std::vector<int> values = Sequence(100000);
+    auto tail = MyRange<int>(values).Reverse().Take(3);
+    CHECK(Optimized(tail.Explain()).find("ReverseTake(3)") != std::string::npos);
+    CHECK(tail.ToVector() == std::vector<int>({999, 998, 997}));
+    CHECK(MyRange<int>(std::vector<int>{1, 2}).Reverse().Take(5).ToVector() == std::vector<int>({2, 1}));
+    size_t calls = 0;
+    auto none = MyRange<int>(values).Where([&calls](int) { ++calls; return true; }).Reverse().Take(0);
+    CHECK(none.ToVector().empty());
+    CHECK(calls < values.size());
+    calls = 0;
+    auto filtered = MyRange<int>(values).Where([&calls](int x) { ++calls; return x % 2 == 0; }).Reverse().Take(2);
+    CHECK(filtered.ToVector() == std::vector<int>({998, 996}));
+    CHECK(calls == values.size());
+}
+
+// Count drops operations that cannot change the number of elements; it must agree with
+// counting the evaluated range
+TEST(CountPlanMatchesEvaluation) {
+    const MyRange<int> numbers(Numbers());
+    auto identity = [](int x) { return x; };
+    const std::vector<std::pair<MyRange<int>, size_t>> cases = {
+        {numbers.Select([](int x) { return x * 2; }), 300},
+        {numbers.OrderBy(identity).Where(IsEven), Filtered(Numbers(), IsEven).size()},
+        {numbers.Distinct(), DistinctOf(Numbers()).size()},
+        {numbers.Select([](int x) { return x / 2; }).Distinct(), 0},
+        {numbers.Reverse().Take(10).Distinct(), 0},
+        {numbers.OrderBy(identity).Take(50).Distinct(), 0},
+        {numbers.OrderBy(identity).Take(50), 50},
+        {numbers.Where(IsSmall).Reverse().Skip(3), Filtered(Numbers(), IsSmall).size() - 3},
+        {numbers.Concat(numbers.Take(5)).Distinct(), DistinctOf(Numbers()).size()},
+        {numbers.DistinctBy([](int x) { return x % 10; }).Take(4), 4},
+        {numbers.Skip(295).Select([](int x) { return x + 1; }), 5},
+    };
+    for (const auto& [range, expected] : cases) {
+        const size_t evaluated = MyRange<int>(range).ToVector().size();
+        CHECK(range.Count() == evaluated);
+        if (expected != 0) CHECK(range.Count() == expected);
+    }
+}
+
+// From views lvalue containers in place but must own the elements of temporaries, which are
+// gone before the range is used
+
+TEST(FromViewsLvalueContainers) {
+    std::vector<int> values{1, 2, 3};
+    auto range = From(values);
+    values[0] = 10;
+    CHECK(range.ToVector() == std::vector<int>({10, 2, 3}));
+}
+
+TEST(FromOwnsTemporaryContainers) {
+    auto large = [](int x) { return x > 2; };
+    CHECK(From(std::vector<int>{1, 3, 5}).Where(large).Count() == 2);
+    CHECK(From(std::list<int>{1, 3, 5}).Where(large).Count() == 2);
+    CHECK(From(std::set<int>{5, 1, 3}).Where(large).ToVector() == std::vector<int>({3, 5}));
+    CHECK(From(std::deque<int>{1, 3, 5}).Where(large).Count() == 2);
+    CHECK(From(std::map<int, std::string>{{2, "b"}, {1, "a"}}).ToVector() == std::vector<std::string>({"a", "b"}));
+    using Array = int[3];
+    CHECK(From(Array{1, 3, 5}).Where(large).Count() == 2);
+    auto strings = From(std::list<std::string>{"first string long enough to allocate", "second"});
+    CHECK(strings.ElementAt(0) == "first string long enough to allocate");
+}
+
+TEST(StringOperators) {
+    const MyRange<std::string> words(std::vector<std::string>{"ab", "", "Straße"});
+    CHECK(words.AddPrefix("<").AddSuffix(">").ToVector() == std::vector<std::string>({"<ab>", "<>", "<Straße>"}));
+    CHECK(words.ToUpperCase().ToVector() == std::vector<std::string>({"AB", "", "STRAßE"}));
+    const StringRange arena = words.ToStringRange().AddPrefix("x").ToUpperCase();
+    CHECK(arena.ToVector() == std::vector<std::string>({"XAB", "X", "XSTRAßE"}));
+}
+
+// Parallel execution. main runs several OpenMP threads even on one core, so ranges in
+// AsParallel mode are split and the threads that handled their elements can be told apart
+
+class ThreadSet {
+public:
+    void Mark() {
+#ifdef _OPENMP
+        mask_ |= uint64_t(1) << (omp_get_thread_num() % 64);
+#endif
+    }
+    // True when more than one thread marked, or OpenMP is off and nothing could run in parallel
+    bool RanInParallel() const {
+#ifdef _OPENMP
+        return __builtin_popcountll(mask_.load()) > 1;
+#else
+        return true;
+#endif
+    }
+private:
+    std::atomic<uint64_t> mask_{0};
+};
+
+TEST(PipelineKeepsParallelMode) {
+    ThreadSet threads;
+    MyRange<int> range = MyRange<int>(Sequence(100000)).AsParallel(1000).AsPipeline()
+                             .Where([&threads](int x) { threads.Mark(); return x % 3 == 0; })
+                             .Select([](int x) { return x * 2; })
+                             .ToRange();
+    long long expected = 0;
+    for (int x : Sequence(100000)) expected += x % 3 == 0 ? x * 2 : 0;
+    CHECK(range.Sum() == expected);
+    CHECK(threads.RanInParallel());
+    CHECK(MyRange<int>(Sequence(100)).AsPipeline().Take(5).Skip(2).ToRange().ToVector() == std::vector<int>({2, 3, 4}));
+}
+
+TEST(ParallelAllAny) {
+    ThreadSet threads;
+    const MyRange<int> range = MyRange<int>(Sequence(100000)).AsParallel(1000);
+    CHECK(range.All([&threads](int x) { threads.Mark(); return x < 1000; }));
+    CHECK(threads.RanInParallel());
+    CHECK(!range.All([](int x) { return x != 999; }));
+    CHECK(range.Any([](int x) { return x == 999; }));
+    CHECK(!range.Any([](int x) { return x < 0; }));
+    const MyRange<int> odd = range.Where([](int x) { return x % 2 == 1; });
+    CHECK(odd.All([](int x) { return x % 2 == 1; }));
+    CHECK(!odd.Any([](int x) { return x == 0; }));
+    CHECK(MyRange<int>().AsParallel(0).All([](int) { return false; }));
+    CHECK(!MyRange<int>().AsParallel(0).Any([](int) { return true; }));
+}
+
+// Aggregates over a filtered chain fold whole batches; compare them with plain loops
+TEST(AggregatesOverChains) {
+    const std::vector<int> values = Sequence(100000);
+    long long sum = 0;
+    size_t count = 0;
+    int min = INT_MAX, max = INT_MIN;
+    for (int x : values) {
+        if (x % 7 == 3) continue;
+        const int y = x * 3 - 1000;
+        sum += y;
+        ++count;
+        min = std::min(min, y);
+        max = std::max(max, y);
+    }
+    for (bool parallel : {false, true}) {
+        MyRange<int> range(values);
+        if (parallel) range = range.AsParallel(1000);
+        const auto chain = range.Where([](int x) { return x % 7 != 3; }).Select([](int x) { return x * 3 - 1000; });
+        CHECK(chain.Sum() == sum);
+        CHECK(chain.Average() == static_cast<double>(sum) / count);
+        CHECK(chain.Min() == min);
+        CHECK(chain.Max() == max);
+        CHECK(chain.MinMax() == std::make_pair(min, max));
+        const auto halves = chain.Select([](int x) { return x / 2.0; });
+        CHECK(halves.Sum() == sum / 2.0);
+        CHECK(halves.MinMax() == std::make_pair(min / 2.0, max / 2.0));
+    }
+    const auto none = MyRange<int>(values).Where([](int x) { return x < 0; });
+    CHECK(none.Sum() == 0);
+    CHECK(none.Average() == 0);
+    bool threw = false;
+    try {
+        none.Min();
+    } catch (const std::logic_error&) {
+        threw = true;
+    }
+    CHECK(threw);
+}
+
+// Live aggregates fold in only what was appended since the previous read
+
+TEST(LiveAggregatesFoldAppends) {
+    LiveRange<int> source;
+    int calls = 0;
+    auto count = source.Where([&calls](int x) { ++calls; return x % 2 == 0; }).Count();
+    auto sum = source.Select([](int x) { return x * 10; }).Sum();
+    auto min = source.Query().Min();
+    auto distinct = source.Query().Distinct();
+    source.Append(std::vector<int>{4, 7, 2, 7});
+    CHECK(count.Value() == 2);
+    CHECK(sum.Value() == 200);
+    CHECK(min.Value() == 2);
+    CHECK(distinct.Value() == std::vector<int>({4, 7, 2}));
+    CHECK(count.Consumed() == 4);
+    CHECK(calls == 4);
+    source.Append(std::vector<int>{1, 8, 4});
+    CHECK(count.Consumed() == 4);
+    CHECK(count.Value() == 4);
+    CHECK(sum.Value() == 330);
+    CHECK(min.Value() == 1);
+    CHECK(distinct.Value() == std::vector<int>({4, 7, 2, 1, 8}));
+    CHECK(count.Consumed() == 7);
+    CHECK(distinct.Consumed() == 7);
+    CHECK(count.Value() == 4);
+    CHECK(calls == 7);
+    CHECK(source.Snapshot().Count() == 7);
+}
+
+TEST(LiveAggregatesOfEmptySource) {
+    LiveRange<int> source;
+    auto count = source.Query().Count();
+    auto min = source.Query().Min();
+    CHECK(count.Value() == 0);
+    CHECK(count.Consumed() == 0);
+    bool threw = false;
+    try {
+        min.Value();
+    } catch (const std::logic_error&) {
+        threw = true;
+    }
+    CHECK(threw);
+    source.Append(3);
+    CHECK(min.Value() == 3);
+}
+
+TEST(LiveGroupingFoldsAppends) {
+    using Pair = std::pair<int, int>;
+    LiveRange<Pair> source;
+    auto sums = source.Query().GroupBy([](const Pair& p) { return p.first; }).Sum([](const Pair& p) { return p.second; });
+    source.Append(std::vector<Pair>{{1, 5}, {2, 3}, {1, 1}});
+    CHECK(sums.Value() == std::vector<Pair>({{1, 6}, {2, 3}}));
+    CHECK(sums.Consumed() == 3);
+    source.Append(std::vector<Pair>{{3, 9}, {2, 4}});
+    CHECK(sums.Value() == std::vector<Pair>({{1, 6}, {2, 7}, {3, 9}}));
+    CHECK(sums.Consumed() == 5);
+}
+
+// Column ranges, checked against plain loops over the same rows
+
+struct Order {
+    int id;
+    int quantity;
+    double price;
+};
+
+std::vector<Order> Orders(int count) {
+    std::vector<Order> orders;
+    for (int i = 0; i < count; ++i) orders.push_back({i, (i * 37) % 101, (i % 13) * 1.5});
+    return orders;
+}
+
+TEST(ColumnWhereSelect) {
+    const auto orders = Orders(10000);
+    std::vector<int> expected;
+    for (const auto& order : orders) {
+        if (order.quantity > 50 && order.price < 9) expected.push_back(order.id);
+    }
+    const auto columns = MakeColumnRange(orders, &Order::id, &Order::quantity, &Order::price);
+    const auto filtered = columns.Where<1>([](int quantity) { return quantity > 50; })
+                              .Where<2>([](double price) { return price < 9; });
+    CHECK(filtered.Select<0>().ToVector() == expected);
+    CHECK(filtered.Count() == expected.size());
+    CHECK(columns.Count() == orders.size());
+    CHECK(columns.Where<1>([](int) { return false; }).Select<0>().Count() == 0);
+}
+
+TEST(ColumnWhereSelectParallel) {
+    const auto orders = Orders(100000);
+    std::vector<int> expected;
+    for (const auto& order : orders) {
+        if (order.quantity % 3 == 0) expected.push_back(order.id);
+    }
+    ThreadSet threads;
+    const auto filtered = MakeColumnRange(orders, &Order::id, &Order::quantity, &Order::price)
+                              .AsParallel(1000)
+                              .Where<1>([&threads](int quantity) { threads.Mark(); return quantity % 3 == 0; });
+    CHECK(filtered.Select<0>().ToVector() == expected);
+    CHECK(filtered.Count() == expected.size());
+    CHECK(threads.RanInParallel());
+}
+
+int main(int argc, char** argv) {
+#ifdef _OPENMP
+    omp_set_num_threads(4);
+#endif
+    const std::string filter = argc > 1 ? argv[1] : "";
+    size_t run = 0;
+    for (const auto& test : Tests()) {
+        if (!filter.empty() && std::string(test.name).find(filter) == std::string::npos) continue;
+        const int before = failures;
+        test.run();
+        ++run;
+        std::printf("%s %s\n", failures == before ? "PASS" : "FAIL", test.name);
+    }
+    std::printf("%zu tests, %d failed checks\n", run, failures);
+    return failures == 0 ? 0 : 1;
+}
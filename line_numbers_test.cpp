@@ -0,0 +1,40 @@
+#include <iostream>
+#include <utility>
+#include <vector>
+#include "laic.h"
+
+// Bracketed operators spanning several lines, built with --fuse-loops. Each check compares
+// __LINE__ with the line it is written on, so the line_numbers test fails when the
+// preprocessed code maps lines after a rewrite back to the wrong input line
+static int failures = 0;
+
+static void checkLine(int line, int expected) {
+    if (line != expected) {
+        std::cout << "__LINE__ is " << line << ", expected " << expected << std::endl;
+        ++failures;
+    }
+}
+
+int main() {
+    MyRange<std::pair<int, int>> owners(std::vector<std::pair<int, int>>{{1, 10}, {2, 20}});
+    MyRange<std::pair<int, int>> pets(std::vector<std::pair<int, int>>{{1, 100}, {1, 101}, {2, 200}});
+    MyRange<int> range(std::vector<int>{1, 2, 3, 4, 5});
+
+#ssb
+    auto joined = owners.Join[pets;
+                              value.first;
+                              value.first;
+                              outer.second + inner.second];
+    checkLine(__LINE__, 28);
+    std::cout << "Join Sum: " << joined.Sum() << std::endl;
+#esb
+    checkLine(__LINE__, 31);
+
+#ssb
+    std::cout << "Take Count: " << range.Take(
+        3).Count() << std::endl;
+#esb
+    checkLine(__LINE__, 37);
+
+    return failures == 0 ? 0 : 1;
+}
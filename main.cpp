@@ -37,6 +37,7 @@ int main() {
     int maxResult;
     size_t countResult;
     float averageResult;
+    int pipelineSumResult;
 
     // Special block for operations
 #ssb
@@ -55,10 +56,8 @@ int main() {
     toListResult = rangeData.Where[value > 4].ToList();
     toDequeResult = rangeData.ToDeque();
     toVectorResult = rangeData.ToVector();
-    minResult = rangeData.Where[value > 2].Select[value * 2].Min();
-    maxResult = rangeData.Where[value > 2].Select[value * 2].Max();
-    averageResult = rangeData.Where[value > 2].Select[value * 2].Average();
-    countResult = rangeData.Where[value > 2].Select[value * 2].Count();
+    std::tie(minResult, maxResult, averageResult, countResult) = rangeData.Where[value > 2].Select[value * 2].Aggregate(Min(), Max(), Average(), Count());
+    pipelineSumResult = rangeData.AsPipeline().Where[value > 2].Select[value * 2].Sum();
 #esb
 
     // Output results
@@ -81,6 +80,7 @@ int main() {
     std::cout << "Max: " << maxResult << std::endl;
     std::cout << "Count: " << countResult << std::endl;
     std::cout << "Average: " << averageResult << std::endl;
+    std::cout << "Pipeline Sum: " << pipelineSumResult << std::endl;
 
 
     return 0;
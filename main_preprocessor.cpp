@@ -1,7 +1,69 @@
-#include <fstream>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <vector>
 #include "preprocessor.h"
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+static void usage() {
+    std::cerr << "Usage: preprocessor [--no-line] [--fuse-loops] [--force] [-j THREADS] [INPUT OUTPUT]...\n"
+                 "Preprocesses each INPUT into OUTPUT, several files at once, skipping outputs already\n"
+                 "generated from the same input. Without files, main.cpp is preprocessed into\n"
+                 "processed_main.cpp. --fuse-loops compiles chains of Where, Select, Take and Skip ending\n"
+                 "in Count, Sum, Min, Max, Average, Any or All into plain loops" << std::endl;
+}
 
 int main(int argc, char** argv) {
-    preprocessCode("main.cpp", "processed_main.cpp");
-    return 0;
+    PreprocessOptions options;
+    std::vector<std::string> files;
+    int threads = 0;
+    for (int i = 1; i < argc; ++i) {
+        const std::string arg = argv[i];
+        if (arg == "--no-line") {
+            options.lineDirectives = false;
+        } else if (arg == "--fuse-loops") {
+            options.fuseLoops = true;
+        } else if (arg == "--force") {
+            options.force = true;
+        } else if (arg == "-j" && i + 1 < argc) {
+            threads = std::atoi(argv[++i]);
+        } else if (!arg.empty() && arg[0] == '-') {
+            usage();
+            return arg == "--help" ? 0 : 2;
+        } else {
+            files.push_back(arg);
+        }
+    }
+    if (files.empty()) files = {"main.cpp", "processed_main.cpp"};
+    if (files.size() % 2 != 0) {
+        usage();
+        return 2;
+    }
+
+    // One task per file; files are independent, so they are handed out as threads free up
+    const int count = static_cast<int>(files.size() / 2);
+    std::vector<PreprocessResult> results(count);
+#ifdef _OPENMP
+    if (threads > 0) omp_set_num_threads(threads);
+#endif
+#pragma omp parallel for schedule(dynamic)
+    for (int i = 0; i < count; ++i) {
+        results[i] = preprocessCode(files[2 * i], files[2 * i + 1], options);
+    }
+
+    int written = 0, upToDate = 0, failed = 0;
+    for (int i = 0; i < count; ++i) {
+        if (results[i] == PreprocessResult::Written) {
+            ++written;
+            std::cout << "Preprocessed " << files[2 * i] << " into " << files[2 * i + 1] << std::endl;
+        } else if (results[i] == PreprocessResult::UpToDate) {
+            ++upToDate;
+        } else {
+            ++failed;
+        }
+    }
+    std::cout << written << " written, " << upToDate << " up to date, " << failed << " failed" << std::endl;
+    return failed > 0 ? 1 : 0;
 }
@@ -3,94 +3,430 @@
 #include <fstream>
 #include <sstream>
 #include <string>
-#include <regex>
-#include <omp.h>
+#include <algorithm>
+#include <cctype>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
 
-// Function to process special lines
-std::string processSpecialLine(const std::string& blockContent) {
-    std::string processedContent = blockContent;
+// Operator written with a bracketed body, such as .Where[value > 3]. The body holds one part
+// per lambda parameter list, separated by top-level semicolons; a null entry passes its part
+// through as an ordinary argument, e.g. the inner range of .Join[inner; value.id; value.ownerId; ...]
+struct BracketOperator {
+    const char* name;
+    std::vector<const char*> parameters;
+};
 
-    // Transform operations with proper lambda function handling and variable capturing
-    processedContent = std::regex_replace(processedContent, std::regex(R"(\.OrderBy\[(.*?)\])"), ".OrderBy([&](auto value){ return $1; })");
-    processedContent = std::regex_replace(processedContent, std::regex(R"(\.GroupBy\[(.*?)\])"), ".GroupBy([&](auto value){ return $1; })");
-    processedContent = std::regex_replace(processedContent, std::regex(R"(\.Select\[(.*?)\])"), ".Select([&](auto value){ return $1; })");
-    processedContent = std::regex_replace(processedContent, std::regex(R"(\.Where\[(.*?)\])"), ".Where([&](auto value){ return $1; })");
-    processedContent = std::regex_replace(processedContent, std::regex(R"(\.All\[(.*?)\])"), ".All([&](auto value){ return $1; })");
-    processedContent = std::regex_replace(processedContent, std::regex(R"(\.Any\[(.*?)\])"), ".Any([&](auto value){ return $1; })");
+static const std::vector<BracketOperator>& bracketOperators() {
+    static const std::vector<BracketOperator> operators = [] {
+        std::vector<BracketOperator> result;
+        for (const char* name : {"Where", "Select", "All", "Any", "OrderBy", "OrderByDescending", "ThenBy", "ThenByDescending",
+                                 "GroupBy", "DistinctBy", "MinBy", "MaxBy", "Sum", "Average", "Min", "Max"}) {
+            result.push_back({name, {"(auto value)"}});
+        }
+        result.push_back({"Join", {nullptr, "(auto value)", "(auto value)", "(auto outer, auto inner)"}});
+        result.push_back({"GroupJoin", {nullptr, "(auto value)", "(auto value)", "(auto outer, auto inner)"}});
+        result.push_back({"Aggregate", {nullptr, "(auto accumulator, auto value)"}});
+        return result;
+    }();
+    return operators;
+}
 
-    return processedContent;
+static const BracketOperator* findBracketOperator(const std::string& code, size_t first, size_t last) {
+    for (const auto& op : bracketOperators()) {
+        if (code.compare(first, last - first, op.name) == 0) return &op;
+    }
+    return nullptr;
 }
 
-// Function to process special blocks
-std::string processSpecialBlock(const std::vector<std::string>& blockContent) {
-    std::string processedContent = "{\n";
-    // Use OpenMP to parallelize the processing of each line
-    // Write the processed lines to the processedContent string in the correct order
-    // Set number of threads to 4
-    // Split vector processing among threads
-    std::vector<std::string> processedLines(blockContent.size());
-    std::vector<std::vector<int>> threadAssignments(4);
-#pragma omp parallel for num_threads(4) default(none) shared(blockContent, threadAssignments, processedLines)
-    for (int i = 0; i < blockContent.size(); i++) {
-#pragma omp critical
-        {
-            threadAssignments[omp_get_thread_num()].push_back(i);
+static bool isIdentifierChar(char c) {
+    return std::isalnum(static_cast<unsigned char>(c)) || c == '_';
+}
+
+// End of the string or character literal whose opening quote is at i
+static size_t literalEnd(const std::string& code, size_t i, bool raw) {
+    const char quote = code[i];
+    if (raw) {
+        const size_t open = code.find('(', i);
+        if (open == std::string::npos) return code.size();
+        const std::string terminator = ")" + code.substr(i + 1, open - i - 1) + "\"";
+        const size_t close = code.find(terminator, open);
+        return close == std::string::npos ? code.size() : close + terminator.size();
+    }
+    for (++i; i < code.size(); ++i) {
+        if (code[i] == '\\') ++i;
+        else if (code[i] == quote || code[i] == '\n') return i + 1;
+    }
+    return code.size();
+}
+
+// End of the token starting at i: a literal, a comment, an identifier, a number or a single
+// character. Literals and comments are skipped whole, so brackets inside them are not counted
+static size_t tokenEnd(const std::string& code, size_t i) {
+    const char c = code[i];
+    const char next = i + 1 < code.size() ? code[i + 1] : '\0';
+    if (c == '"' || c == '\'') return literalEnd(code, i, false);
+    if (c == '/' && next == '/') {
+        const size_t end = code.find('\n', i);
+        return end == std::string::npos ? code.size() : end;
+    }
+    if (c == '/' && next == '*') {
+        const size_t end = code.find("*/", i + 2);
+        return end == std::string::npos ? code.size() : end + 2;
+    }
+    if (std::isdigit(static_cast<unsigned char>(c)) || (c == '.' && std::isdigit(static_cast<unsigned char>(next)))) {
+        // Numbers run over digit separators and signed exponents, e.g. 1'000 and 1e-3
+        size_t end = i + 1;
+        while (end < code.size()) {
+            const char d = code[end];
+            if (isIdentifierChar(d) || d == '.') {
+                ++end;
+            } else if ((d == '\'' && end + 1 < code.size() && isIdentifierChar(code[end + 1])) ||
+                       ((d == '+' || d == '-') && std::strchr("eEpP", code[end - 1]))) {
+                end += 1;
+            } else {
+                break;
+            }
+        }
+        return end;
+    }
+    if (isIdentifierChar(c)) {
+        size_t end = i + 1;
+        while (end < code.size() && isIdentifierChar(code[end])) ++end;
+        // Encoding and raw string prefixes belong to the literal they introduce
+        if (end < code.size() && (code[end] == '"' || code[end] == '\'')) {
+            const std::string prefix = code.substr(i, end - i);
+            for (const char* candidate : {"u8", "u", "U", "L"}) {
+                if (prefix == candidate) return literalEnd(code, end, false);
+            }
+            for (const char* candidate : {"R", "u8R", "uR", "UR", "LR"}) {
+                if (prefix == candidate && code[end] == '"') return literalEnd(code, end, true);
+            }
+        }
+        return end;
+    }
+    return i + 1;
+}
+
+// Splits the bracketed body opening at open into its parts at top-level semicolons. Returns
+// the position of the closing bracket, or npos when the body is not closed
+static size_t splitBracketBody(const std::string& code, size_t open, std::vector<std::string>& parts) {
+    int depth = 0;
+    size_t partStart = open + 1;
+    for (size_t i = open + 1; i < code.size();) {
+        const char c = code[i];
+        if (c == '(' || c == '[' || c == '{') {
+            ++depth;
+        } else if (c == ')' || c == '}' || (c == ']' && depth > 0)) {
+            --depth;
+        } else if (c == ']') {
+            parts.push_back(code.substr(partStart, i - partStart));
+            return i;
+        } else if (c == ';' && depth == 0) {
+            parts.push_back(code.substr(partStart, i - partStart));
+            partStart = i + 1;
+        }
+        i = tokenEnd(code, i);
+    }
+    return std::string::npos;
+}
+
+static std::string trim(const std::string& text) {
+    const size_t first = text.find_first_not_of(" \t\r\n");
+    if (first == std::string::npos) return std::string();
+    return text.substr(first, text.find_last_not_of(" \t\r\n") - first + 1);
+}
+
+// End of the parenthesized argument list opening at open, or npos when it is not closed
+static size_t argumentsEnd(const std::string& code, size_t open) {
+    int depth = 0;
+    for (size_t i = open; i < code.size();) {
+        if (code[i] == '(') ++depth;
+        else if (code[i] == ')' && --depth == 0) return i + 1;
+        i = tokenEnd(code, i);
+    }
+    return std::string::npos;
+}
+
+// True when the identifier at i starts a postfix expression rather than naming a member
+static bool startsExpression(const std::string& code, size_t i) {
+    while (i > 0 && std::isspace(static_cast<unsigned char>(code[i - 1]))) --i;
+    if (i == 0) return true;
+    const char c = code[i - 1];
+    if (c == '.') return false;
+    // After an identifier only a keyword such as return can precede an expression
+    if (isIdentifierChar(c)) return i >= 6 && code.compare(i - 6, 6, "return") == 0 && (i == 6 || !isIdentifierChar(code[i - 7]));
+    if (c == ':' && i >= 2 && code[i - 2] == ':') return false;
+    if (c == '>' && i >= 2 && code[i - 2] == '-') return false;
+    return true;
+}
+
+// Compiles a chain such as source.Where[...].Select[...].Take(n).Sum() starting at the
+// identifier at first into one loop over source, inside an immediately invoked lambda so it
+// stays an expression. Only Where, Select, Take and Skip stages ending in Count, Sum, Min,
+// Max, Average, Any or All are fused, and only chains with at least one stage; anything else
+// returns false and is rewritten as usual. The loop keeps the line count of the chain
+std::string processSpecialCode(const std::string& code, bool fuseLoops);
+
+static bool fuseChain(const std::string& code, size_t first, size_t& end, std::string& loop) {
+    const size_t sourceEnd = tokenEnd(code, first);
+    const std::string source = code.substr(first, sourceEnd - first);
+    std::string setup, body;
+    // Type of the current element, as an expression to pass to decltype
+    std::string element = "*std::begin(std::as_const(" + source + "))";
+    std::string value = "laicElement";
+    std::string terminal, predicate;
+    int stages = 0;
+    size_t i = sourceEnd;
+    while (terminal.empty()) {
+        if (i >= code.size() || code[i] != '.' || i + 1 >= code.size() || !std::isalpha(static_cast<unsigned char>(code[i + 1]))) return false;
+        const size_t nameEnd = tokenEnd(code, i + 1);
+        const std::string name = code.substr(i + 1, nameEnd - i - 1);
+        if (nameEnd >= code.size()) return false;
+        const std::string stage = "laicStage" + std::to_string(stages);
+        if (code[nameEnd] == '[') {
+            std::vector<std::string> parts;
+            const size_t close = splitBracketBody(code, nameEnd, parts);
+            if (close == std::string::npos || parts.size() != 1) return false;
+            const std::string lambda = "[&](auto value){ return " + processSpecialCode(parts[0], true) + "; }";
+            if (name == "Where") {
+                setup += "auto " + stage + " = " + lambda + "; ";
+                body += "if (!" + stage + "(" + value + ")) continue; ";
+            } else if (name == "Select") {
+                setup += "auto " + stage + " = " + lambda + "; ";
+                body += "[[maybe_unused]] auto&& laicValue" + std::to_string(stages) + " = " + stage + "(" + value + "); ";
+                element = stage + "(" + element + ")";
+                value = "laicValue" + std::to_string(stages);
+            } else if (name == "Any" || name == "All") {
+                terminal = name;
+                predicate = lambda;
+            } else {
+                return false;
+            }
+            i = close + 1;
+        } else if (code[nameEnd] == '(') {
+            const size_t close = argumentsEnd(code, nameEnd);
+            if (close == std::string::npos) return false;
+            const std::string arguments = trim(code.substr(nameEnd + 1, close - nameEnd - 2));
+            if (name == "Take" || name == "Skip") {
+                if (arguments.empty()) return false;
+                setup += "size_t " + stage + " = static_cast<size_t>(" + processSpecialCode(arguments, true) + "); ";
+                body += name == "Skip" ? "if (" + stage + " > 0) { --" + stage + "; continue; } "
+                                       : "if (" + stage + " == 0) break; --" + stage + "; ";
+            } else if (arguments.empty() && (name == "Count" || name == "Sum" || name == "Min" || name == "Max" || name == "Average")) {
+                terminal = name;
+            } else {
+                return false;
+            }
+            i = close;
+        } else {
+            return false;
         }
-        processedLines[i] = processSpecialLine(blockContent[i]);
+        if (terminal.empty()) ++stages;
     }
+    if (stages == 0) return false;
 
-    for (const auto& line : processedLines) {
-        processedContent += line + "\n";
+    const std::string type = "std::decay_t<decltype(" + element + ")>";
+    std::string init, step, result;
+    if (terminal == "Count") {
+        init = "size_t laicResult = 0; ";
+        step = "++laicResult; ";
+        result = "laicResult";
+    } else if (terminal == "Sum") {
+        init = "using LaicValue = " + type + "; LaicValue laicResult = LaicValue(0); ";
+        step = "laicResult = laicResult + " + value + "; ";
+        result = "laicResult";
+    } else if (terminal == "Average") {
+        init = "using LaicValue = " + type + "; LaicValue laicSum = LaicValue(0); size_t laicCount = 0; ";
+        step = "laicSum = laicSum + " + value + "; ++laicCount; ";
+        result = "laicCount == 0 ? 0.0 : static_cast<double>(laicSum) / laicCount";
+    } else if (terminal == "Min" || terminal == "Max") {
+        const std::string better = terminal == "Min" ? value + " < *laicResult" : "*laicResult < " + value;
+        init = "std::optional<" + type + "> laicResult; ";
+        step = "if (!laicResult || " + better + ") laicResult = " + value + "; ";
+        result = "laicResult ? *laicResult : throw std::logic_error(\"Empty range\")";
+    } else {
+        init = "auto laicPredicate = " + predicate + "; ";
+        step = terminal == "Any" ? "if (laicPredicate(" + value + ")) return true; " : "if (!laicPredicate(" + value + ")) return false; ";
+        result = terminal == "Any" ? "false" : "true";
     }
-    std::cout << "-----------------------------------------------------" << std::endl;
-    for (int i = 0; i < threadAssignments.size(); i++) {
-        for (const auto &lineIndex: threadAssignments[i]) {
-            std::cout << "Thread " << i << " processed line " << lineIndex << std::endl;
+    loop = "[&]() { " + setup + init + "for ([[maybe_unused]] const auto& laicElement : std::as_const(" + source + ")) { " + body + step + "} return " + result + "; }()";
+    end = i;
+    return true;
+}
+
+// Rewrites every bracketed operator in code, e.g. .Where[value > 3] to
+// .Where([&](auto value){ return value > 3; }), in one pass over the code. Bodies may hold
+// nested brackets, literals and further bracketed operators. With fuseLoops, chains that
+// fuseChain accepts become loops instead
+std::string processSpecialCode(const std::string& code, bool fuseLoops) {
+    std::string result;
+    result.reserve(code.size() + code.size() / 2);
+    size_t i = 0;
+    while (i < code.size()) {
+        size_t end = tokenEnd(code, i);
+        std::string loop;
+        if (fuseLoops && (std::isalpha(static_cast<unsigned char>(code[i])) || code[i] == '_') && end < code.size() && code[end] == '.' &&
+            startsExpression(code, i) && fuseChain(code, i, end, loop)) {
+            result += loop;
+            i = end;
+            continue;
         }
+        if (code[i] == '.' && end == i + 1 && end < code.size() && isIdentifierChar(code[end]) && !std::isdigit(static_cast<unsigned char>(code[end]))) {
+            const size_t nameEnd = tokenEnd(code, end);
+            const BracketOperator* op = nameEnd < code.size() && code[nameEnd] == '[' ? findBracketOperator(code, end, nameEnd) : nullptr;
+            std::vector<std::string> parts;
+            const size_t close = op ? splitBracketBody(code, nameEnd, parts) : std::string::npos;
+            if (op && close == std::string::npos) {
+                std::cerr << "Unterminated ." << op->name << "[ left unchanged" << std::endl;
+            } else if (op && parts.size() != op->parameters.size()) {
+                std::cerr << "." << op->name << "[...] takes " << op->parameters.size() << " part(s), got " << parts.size() << "; left unchanged" << std::endl;
+            } else if (op) {
+                result += '.';
+                result += op->name;
+                result += '(';
+                for (size_t part = 0; part < parts.size(); ++part) {
+                    if (part > 0) result += ", ";
+                    // A single part is kept exactly as written; several are trimmed, but the newlines
+                    // around each are kept so that the lines after it stay where they were
+                    const std::string& text = parts[part];
+                    const size_t first = parts.size() == 1 ? 0 : std::min(text.find_first_not_of(" \t\r\n"), text.size());
+                    const size_t last = parts.size() == 1 ? text.size() : std::max(first, text.find_last_not_of(" \t\r\n") + 1);
+                    std::string body = processSpecialCode(text.substr(first, last - first), fuseLoops);
+                    result.append(std::count(text.begin(), text.begin() + first, '\n'), '\n');
+                    if (op->parameters[part]) {
+                        result += "[&]";
+                        result += op->parameters[part];
+                        result += "{ return " + body + "; }";
+                    } else {
+                        result += body;
+                    }
+                    result.append(std::count(text.begin() + last, text.end(), '\n'), '\n');
+                }
+                result += ')';
+                i = close + 1;
+                continue;
+            }
+            end = nameEnd;
+        }
+        result.append(code, i, end - i);
+        i = end;
     }
-    std::cout << "-----------------------------------------------------" << std::endl;
+    return result;
+}
 
-    processedContent += "}\n";
-    return processedContent;
+// Function to process special blocks
+std::string processSpecialBlock(const std::vector<std::string>& blockContent, bool fuseLoops) {
+    // The block is rewritten as a whole, so bracketed bodies may span lines
+    std::string code;
+    for (const auto& line : blockContent) {
+        code += line + "\n";
+    }
+    return "{\n" + processSpecialCode(code, fuseLoops) + "}\n";
 }
 
-// Function for preprocessing code
-void preprocessCode(const std::string& inputFile, const std::string& outputFile) {
-    std::ifstream infile(inputFile);
-    std::ofstream outfile(outputFile);
+// Changes whenever the generated code changes, so outputs of older versions are regenerated
+static const char* const PreprocessorVersion = "5";
+
+// 64-bit FNV-1a hash
+static uint64_t hashText(uint64_t hash, const std::string& text) {
+    for (char c : text) {
+        hash ^= static_cast<unsigned char>(c);
+        hash *= 0x100000001b3ull;
+    }
+    return hash;
+}
 
-    if (!infile.is_open() || !outfile.is_open()) {
-        std::cerr << "Error opening file." << std::endl;
-        return;
+static std::string quotedPath(const std::string& path) {
+    std::string quoted = "\"";
+    for (char c : path) {
+        if (c == '"' || c == '\\') quoted += '\\';
+        quoted += c;
     }
+    return quoted + "\"";
+}
 
-    outfile << "#include \"laic.h\"\n";
-    outfile << "#include <iostream>\n";
-    outfile << "#include <vector>\n";
-    outfile << "#include <cmath>\n"; // For the sqrt function
+// First line of every output, naming the hash of everything the output is generated from
+static std::string outputHeader(const std::string& inputFile, const std::string& content, const PreprocessOptions& options) {
+    uint64_t hash = hashText(0xcbf29ce484222325ull, PreprocessorVersion);
+    hash = hashText(hash, options.lineDirectives ? "line" : "noline");
+    hash = hashText(hash, options.fuseLoops ? "fuse" : "nofuse");
+    hash = hashText(hash, inputFile);
+    hash = hashText(hash, content);
+    char hex[17];
+    std::snprintf(hex, sizeof(hex), "%016llx", static_cast<unsigned long long>(hash));
+    return "// Generated by the laic preprocessor from " + inputFile + ", input hash " + hex;
+}
 
-    std::cout << "Preprocessing file..." << std::endl;
+// Function for preprocessing code
+PreprocessResult preprocessCode(const std::string& inputFile, const std::string& outputFile, const PreprocessOptions& options) {
+    std::ifstream infile(inputFile, std::ios::binary);
+    if (!infile.is_open()) {
+        std::cerr << "Error opening " << inputFile << std::endl;
+        return PreprocessResult::Failed;
+    }
+    std::stringstream buffer;
+    buffer << infile.rdbuf();
+    const std::string content = buffer.str();
 
-    std::vector<std::string> specialBlock;
+    const std::string header = outputHeader(inputFile, content, options);
+    if (!options.force) {
+        std::ifstream existing(outputFile);
+        std::string firstLine;
+        if (existing.is_open() && std::getline(existing, firstLine) && firstLine == header) return PreprocessResult::UpToDate;
+    }
+
+    std::string output = header + "\n";
+    output += "#include \"laic.h\"\n";
+    output += "#include <iostream>\n";
+    output += "#include <vector>\n";
+    output += "#include <cmath>\n"; // For the sqrt function
+    // Maps every line back to the input. A block keeps its line count unless loops were fused
+    // into it, and is followed by a directive for the line after it either way
+    if (options.lineDirectives) output += "#line 1 " + quotedPath(inputFile) + "\n";
 
+    std::vector<std::string> specialBlock;
+    std::istringstream lines(content);
     std::string line;
     bool inSpecialBlock = false;
+    size_t lineNumber = 0;
 
-    while (std::getline(infile, line)) {
+    while (std::getline(lines, line)) {
+        ++lineNumber;
         if (line == "#ssb") {
             inSpecialBlock = true;
         } else if (line == "#esb") {
             inSpecialBlock = false;
             // Process the content of the special block
-            outfile << processSpecialBlock(specialBlock);
+            output += processSpecialBlock(specialBlock, options.fuseLoops);
             specialBlock.clear();
+            if (options.lineDirectives) output += "#line " + std::to_string(lineNumber + 1) + " " + quotedPath(inputFile) + "\n";
         } else if (inSpecialBlock) {
             specialBlock.push_back(line);
         } else {
-            outfile << line << std::endl;
+            output += line + "\n";
         }
     }
+    if (inSpecialBlock) {
+        std::cerr << inputFile << ": #ssb without #esb" << std::endl;
+        return PreprocessResult::Failed;
+    }
 
-    infile.close();
-    outfile.close();
+    // Written beside the output and renamed over it, so readers never see a partial file
+    const std::filesystem::path outputPath(outputFile);
+    std::error_code error;
+    if (outputPath.has_parent_path()) std::filesystem::create_directories(outputPath.parent_path(), error);
+    const std::string temporaryFile = outputFile + ".tmp";
+    std::ofstream outfile(temporaryFile, std::ios::binary);
+    if (!outfile.is_open() || !(outfile << output) || (outfile.close(), !outfile)) {
+        std::cerr << "Error writing " << outputFile << std::endl;
+        return PreprocessResult::Failed;
+    }
+    std::filesystem::rename(temporaryFile, outputPath, error);
+    if (error) {
+        std::cerr << "Error writing " << outputFile << ": " << error.message() << std::endl;
+        return PreprocessResult::Failed;
+    }
+    return PreprocessResult::Written;
 }
@@ -10,43 +10,88 @@
 #include <array>
 #include <string>
 
-// Function to convert a vector to MyRange
+// Functions viewing a container as MyRange without copying it; the container must outlive
+// every range derived from the result. Temporary containers are moved into the range instead,
+// which then owns its elements
 template <typename T>
 MyRange<T> From(const std::vector<T>& vec) {
-    return MyRange<T>(vec);
+    return MyRange<T>::View(vec);
+}
+
+template <typename T>
+MyRange<T> From(std::vector<T>&& vec) {
+    return MyRange<T>(std::move(vec));
 }
 
-// Function to convert a list to MyRange
 template <typename T>
 MyRange<T> From(const std::list<T>& list) {
-    return MyRange<T>(list);
+    return MyRange<T>::View(list);
+}
+
+template <typename T>
+MyRange<T> From(std::list<T>&& list) {
+    return MyRange<T>(std::move(list));
 }
 
-// Function to convert a set to MyRange
 template <typename T>
 MyRange<T> From(const std::set<T>& set) {
+    return MyRange<T>::View(set);
+}
+
+// Elements of a set are const, so a temporary one is copied
+template <typename T>
+MyRange<T> From(std::set<T>&& set) {
     return MyRange<T>(set);
 }
 
-// Function to convert a map to MyRange
+// Function to view the values of a map as MyRange
 template <typename K, typename T>
 MyRange<T> From(const std::map<K, T>& map) {
-    return MyRange<T>(map);
+    return MyRange<T>::View(map, [](const std::pair<const K, T>& entry) -> const T& { return entry.second; });
+}
+
+template <typename K, typename T>
+MyRange<T> From(std::map<K, T>&& map) {
+    std::vector<T> values;
+    values.reserve(map.size());
+    for (auto& entry : map) values.push_back(std::move(entry.second));
+    return MyRange<T>(std::move(values));
 }
 
-// Function to convert a deque to MyRange
 template <typename T>
 MyRange<T> From(const std::deque<T>& deque) {
-    return MyRange<T>(deque);
+    return MyRange<T>::View(deque);
+}
+
+template <typename T>
+MyRange<T> From(std::deque<T>&& deque) {
+    return MyRange<T>(std::move(deque));
 }
 
-// Function to convert an array to MyRange
 template <typename T, size_t N>
 MyRange<T> From(const T (&arr)[N]) {
-    return MyRange<T>(arr);
+    return MyRange<T>::View(arr);
 }
 
-// Function to preprocess code
-void preprocessCode(const std::string& inputFile, const std::string& outputFile);
+template <typename T, size_t N>
+MyRange<T> From(T (&&arr)[N]) {
+    return MyRange<T>(std::vector<T>(std::make_move_iterator(arr), std::make_move_iterator(arr + N)));
+}
+
+// Outcome of preprocessing one file
+enum class PreprocessResult { Written, UpToDate, Failed };
+
+struct PreprocessOptions {
+    // Emit #line directives so that diagnostics refer to the input file
+    bool lineDirectives = true;
+    // Compile simple chains ending in an aggregate into hand-written loops
+    bool fuseLoops = false;
+    // Regenerate the output even when it was generated from the same input
+    bool force = false;
+};
+
+// Function to preprocess code. The output is left untouched when its header records the hash
+// of the same input and options
+PreprocessResult preprocessCode(const std::string& inputFile, const std::string& outputFile, const PreprocessOptions& options = PreprocessOptions());
 
 #endif // PREPROCESSOR_H
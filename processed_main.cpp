@@ -1,7 +1,9 @@
+// Generated by the laic preprocessor from main.cpp, input hash bd730e723a6d3de2
 #include "laic.h"
 #include <iostream>
 #include <vector>
 #include <cmath>
+#line 1 "main.cpp"
 #include <iostream>
 #include <vector>
 #include <deque>
@@ -41,6 +43,7 @@ int main() {
     int maxResult;
     size_t countResult;
     float averageResult;
+    int pipelineSumResult;
 
     // Special block for operations
 {
@@ -59,11 +62,10 @@ int main() {
     toListResult = rangeData.Where([&](auto value){ return value > 4; }).ToList();
     toDequeResult = rangeData.ToDeque();
     toVectorResult = rangeData.ToVector();
-    minResult = rangeData.Where([&](auto value){ return value > 2; }).Select([&](auto value){ return value * 2; }).Min();
-    maxResult = rangeData.Where([&](auto value){ return value > 2; }).Select([&](auto value){ return value * 2; }).Max();
-    averageResult = rangeData.Where([&](auto value){ return value > 2; }).Select([&](auto value){ return value * 2; }).Average();
-    countResult = rangeData.Where([&](auto value){ return value > 2; }).Select([&](auto value){ return value * 2; }).Count();
+    std::tie(minResult, maxResult, averageResult, countResult) = rangeData.Where([&](auto value){ return value > 2; }).Select([&](auto value){ return value * 2; }).Aggregate(Min(), Max(), Average(), Count());
+    pipelineSumResult = rangeData.AsPipeline().Where([&](auto value){ return value > 2; }).Select([&](auto value){ return value * 2; }).Sum();
 }
+#line 62 "main.cpp"
 
     // Output results
     std::cout << "Skip 2: " << skipResult << std::endl;
@@ -85,6 +87,7 @@ int main() {
     std::cout << "Max: " << maxResult << std::endl;
     std::cout << "Count: " << countResult << std::endl;
     std::cout << "Average: " << averageResult << std::endl;
+    std::cout << "Pipeline Sum: " << pipelineSumResult << std::endl;
 
 
     return 0;